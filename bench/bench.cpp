@@ -0,0 +1,60 @@
+/**
+ * bench.cpp
+ * Benchmark driver: bin/cache_bench [name-prefix ...]
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+volatile uint64_t bench_sink;
+
+static int filter_count;
+static char** filters;
+
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double bench_best(void (*body)(void* context), void* context) {
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double start = bench_now();
+        body(context);
+        double elapsed = bench_now() - start;
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+bool bench_selected(const char* name) {
+    if (filter_count == 0) return true;
+    for (int i = 0; i < filter_count; i++) {
+        if (strncmp(name, filters[i], strlen(filters[i])) == 0) return true;
+    }
+    return false;
+}
+
+void bench_report(const char* name, double value, const char* unit) {
+    printf("%-40s %14.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+void bench_skip(const char* name, const char* reason) {
+    printf("%-40s %14s (%s)\n", name, "-", reason);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    filter_count = argc - 1;
+    filters = argv + 1;
+
+    printf("# cache_simulator benchmarks, best of %d runs\n", BENCH_RUNS);
+    printf("# %-38s %14s %s\n", "name", "value", "unit");
+    run_micro_benchmarks();
+    run_throughput_benchmarks();
+    return 0;
+}
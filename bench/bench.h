@@ -0,0 +1,47 @@
+/**
+ * bench.h
+ * Benchmark harness: timing, repetition and result lines
+ *
+ * Every benchmark runs BENCH_RUNS times and reports its fastest run,
+ * which is the one least disturbed by the rest of the machine. Results
+ * print one per line as "<name> <value> <unit>" in a fixed order and
+ * format, so the output of two builds can be diffed directly.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BENCH_RUNS 5
+
+// Results are folded in here so the compiler cannot drop the measured work
+extern volatile uint64_t bench_sink;
+
+// Seconds on a monotonic clock
+double bench_now(void);
+
+// Fastest of BENCH_RUNS calls of body(context), in seconds
+double bench_best(void (*body)(void* context), void* context);
+
+// True if `name` matches the prefixes given on the command line (or there are none)
+bool bench_selected(const char* name);
+
+void bench_report(const char* name, double value, const char* unit);
+void bench_skip(const char* name, const char* reason);
+
+// Deterministic xorshift64 stream for benchmark inputs
+static inline uint64_t bench_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+void run_micro_benchmarks(void);
+void run_throughput_benchmarks(void);
+
+#endif // BENCH_H
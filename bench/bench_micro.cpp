@@ -0,0 +1,174 @@
+/**
+ * bench_micro.cpp
+ * Microbenchmarks of the cache, replacement and write buffer primitives
+ *
+ * Each run performs MICRO_OPS operations on addresses drawn from a fixed
+ * ring, so the host's own caches hold the simulator state and the numbers
+ * reflect the code path rather than host memory latency.
+ */
+
+#include "bench.h"
+#include "cache.h"
+#include "controller.h"
+#include "replacement.h"
+#include "write_buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MICRO_OPS     (1u << 22)
+#define ADDRESS_RING  4096
+
+// Tags at or above this block number are never inserted, so they always miss
+#define MISS_BLOCK_BASE 0x100000u
+
+typedef struct {
+    Cache* cache;
+    uint32_t addresses[ADDRESS_RING];
+} CacheBench;
+
+static void read_body(void* context) {
+    CacheBench* b = (CacheBench*)context;
+    uint8_t data[8];
+    uint64_t hits = 0;
+    for (uint32_t i = 0; i < MICRO_OPS; i++) {
+        hits += cache_read(b->cache, b->addresses[i & (ADDRESS_RING - 1)], data);
+    }
+    bench_sink += hits;
+}
+
+static void write_body(void* context) {
+    CacheBench* b = (CacheBench*)context;
+    uint8_t data[8] = { 0 };
+    uint64_t hits = 0;
+    for (uint32_t i = 0; i < MICRO_OPS; i++) {
+        hits += cache_write(b->cache, b->addresses[i & (ADDRESS_RING - 1)], data);
+    }
+    bench_sink += hits;
+}
+
+static void insert_body(void* context) {
+    CacheBench* b = (CacheBench*)context;
+    uint64_t ways = 0;
+    for (uint32_t i = 0; i < MICRO_OPS; i++) {
+        ways += cache_insert(b->cache, b->addresses[i & (ADDRESS_RING - 1)], NULL, false);
+    }
+    bench_sink += ways;
+}
+
+// A full cache of `config`'s geometry: block numbers 0 .. lines-1 are resident
+static Cache* create_full_cache(const CacheConfig* config, ReplacementPolicy policy) {
+    CacheConfig level = *config;
+    level.policy = policy;
+    Cache* cache = create_cache_level(&level, false, DEFAULT_RANDOM_SEED);
+    if (!cache) return NULL;
+    uint32_t lines = cache->num_sets * cache->associativity;
+    for (uint32_t block = 0; block < lines; block++) {
+        cache_insert(cache, block << BLOCK_OFFSET_BITS, NULL, false);
+    }
+    return cache;
+}
+
+static void fill_ring(CacheBench* b, bool resident, uint64_t seed) {
+    uint32_t lines = b->cache->num_sets * b->cache->associativity;
+    for (uint32_t i = 0; i < ADDRESS_RING; i++) {
+        uint32_t r = (uint32_t)bench_random(&seed);
+        uint32_t block = resident ? r % lines : MISS_BLOCK_BASE + (r & 0x3FFFFF);
+        b->addresses[i] = (block << BLOCK_OFFSET_BITS) | (r >> 26);
+    }
+}
+
+static void report_per_op(const char* name, double seconds) {
+    bench_report(name, seconds * 1e9 / MICRO_OPS, "ns/op");
+}
+
+static void bench_cache_ops(const CacheConfig* l1) {
+    static CacheBench b;
+    b.cache = create_full_cache(l1, LRU);
+    if (!b.cache) {
+        bench_skip("cache", "could not create the cache");
+        return;
+    }
+
+    fill_ring(&b, true, 1);
+    if (bench_selected("cache_read.hit")) report_per_op("cache_read.hit", bench_best(read_body, &b));
+    if (bench_selected("cache_write.hit")) report_per_op("cache_write.hit", bench_best(write_body, &b));
+    fill_ring(&b, false, 2);
+    if (bench_selected("cache_read.miss")) report_per_op("cache_read.miss", bench_best(read_body, &b));
+    if (bench_selected("cache_write.miss")) report_per_op("cache_write.miss", bench_best(write_body, &b));
+    if (bench_selected("cache_insert.replace")) {
+        report_per_op("cache_insert.replace", bench_best(insert_body, &b));
+    }
+    free_cache(b.cache);
+}
+
+static void victim_body(void* context) {
+    Cache* cache = (Cache*)context;
+    uint64_t ways = 0;
+    uint32_t set_mask = cache->num_sets - 1;
+    for (uint32_t i = 0; i < MICRO_OPS; i++) {
+        ways += get_victim_way(cache, i & set_mask);
+    }
+    bench_sink += ways;
+}
+
+static void bench_victim_selection(const CacheConfig* l2) {
+    static const ReplacementPolicy policies[] = { LRU, RANDOM, FIFO, PLRU, SRRIP, BRRIP, DRRIP };
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "get_victim_way.%s", replacement_policy_name(policies[i]));
+        if (!bench_selected(name)) continue;
+        Cache* cache = create_full_cache(l2, policies[i]);
+        if (!cache) {
+            bench_skip(name, "could not create the cache");
+            continue;
+        }
+        report_per_op(name, bench_best(victim_body, cache));
+        free_cache(cache);
+    }
+}
+
+typedef struct {
+    WriteBuffer* wb;
+    uint32_t blocks;  // Distinct blocks stored to, cycling
+} WriteBufferBench;
+
+static void write_buffer_body(void* context) {
+    WriteBufferBench* b = (WriteBufferBench*)context;
+    WriteBuffer* wb = b->wb;
+    uint8_t data[8] = { 0 };
+    uint64_t inserted = 0;
+    for (uint32_t i = 0; i < MICRO_OPS; i++) {
+        uint32_t address = (i % b->blocks) << BLOCK_OFFSET_BITS | (i & 7);
+        inserted += insert_write_buffer(wb, address, data);
+        // Drain as the enhanced controller does, without touching a cache
+        while (wb->num_entries > wb->drain_threshold) write_buffer_pop(wb);
+    }
+    bench_sink += inserted;
+}
+
+static void bench_write_buffer(void) {
+    static const struct { const char* name; uint32_t blocks; } cases[] = {
+        { "insert_write_buffer.new", 1u << 20 },   // Every store allocates and one drains
+        { "insert_write_buffer.coalesce", 8 },     // Every store merges into a buffered block
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (!bench_selected(cases[i].name)) continue;
+        WriteBufferBench b;
+        b.wb = create_write_buffer(WRITE_BUFFER_SIZE, WRITE_BUFFER_DRAIN_THRESHOLD);
+        b.blocks = cases[i].blocks;
+        if (!b.wb) {
+            bench_skip(cases[i].name, "could not create the write buffer");
+            continue;
+        }
+        report_per_op(cases[i].name, bench_best(write_buffer_body, &b));
+        free_write_buffer(b.wb);
+    }
+}
+
+void run_micro_benchmarks(void) {
+    ControllerConfig config;
+    default_controller_config(&config);
+    bench_cache_ops(&config.l1);
+    bench_victim_selection(&config.l2);
+    bench_write_buffer();
+}
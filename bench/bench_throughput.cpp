@@ -0,0 +1,227 @@
+/**
+ * bench_throughput.cpp
+ * Trace parsing and end-to-end simulation throughput
+ *
+ * Parsing is measured on generated text and binary traces written to a
+ * temporary file, so the input is the same on every machine. End-to-end
+ * runs replay traces/test_large.trace and the built-in workloads
+ * through the basic and enhanced controllers with reporting turned off.
+ */
+
+#include "bench.h"
+#include "trace_parser.h"
+#include "trace_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PARSE_RECORDS     (1u << 20)
+#define SYNTHETIC_RECORDS (1u << 20)
+#define LARGE_TRACE       "traces/test_large.trace"
+
+// Replays of traces/test_large.trace per timed run; it is only ~10k records
+#define LARGE_TRACE_REPEATS 32
+
+typedef struct {
+    const char* filename;
+    uint64_t bytes;
+    uint64_t records;
+} ParseBench;
+
+static void generate_entry(TraceEntry* entry, uint64_t* seed) {
+    uint64_t r = bench_random(seed);
+    entry->op = (TraceOperation)(r & 3);
+    entry->address = (uint32_t)(r >> 8) & 0xFFFFF;
+    entry->size = (uint32_t)(r >> 40) % 8 + 1;
+    memcpy(entry->data, &r, sizeof(entry->data));
+}
+
+// Write PARSE_RECORDS generated records as a USIMM text trace; returns its size
+static uint64_t write_text_trace(FILE* file) {
+    uint64_t seed = 3;
+    for (uint32_t i = 0; i < PARSE_RECORDS; i++) {
+        TraceEntry entry;
+        generate_entry(&entry, &seed);
+        static const char ops[] = { 'I', 'L', 'S', 'M' };
+        fprintf(file, "%c %08x, %u", ops[entry.op], entry.address, entry.size);
+        if (entry.op == TRACE_STORE || entry.op == TRACE_MODIFY) {
+            fprintf(file, ", ");
+            for (uint32_t b = 0; b < entry.size; b++) fprintf(file, "%02x", entry.data[b]);
+        }
+        fprintf(file, "\n");
+    }
+    return (uint64_t)ftell(file);
+}
+
+static uint64_t write_binary_trace(FILE* file) {
+    uint8_t header[BINARY_TRACE_HEADER_SIZE];
+    write_binary_trace_header(header, PARSE_RECORDS);
+    fwrite(header, 1, sizeof(header), file);
+
+    uint64_t seed = 3;
+    uint32_t prev_address = 0;
+    for (uint32_t i = 0; i < PARSE_RECORDS; i++) {
+        TraceEntry entry;
+        uint8_t record[BINARY_TRACE_MAX_RECORD];
+        generate_entry(&entry, &seed);
+        fwrite(record, 1, encode_binary_record(&entry, &prev_address, record), file);
+    }
+    return (uint64_t)ftell(file);
+}
+
+static void parse_body(void* context) {
+    ParseBench* b = (ParseBench*)context;
+    static TraceEntry entries[TRACE_CHUNK_ENTRIES];
+    TraceReader* reader = open_trace_reader(b->filename);
+    if (!reader) return;
+    uint64_t records = 0;
+    uint64_t checksum = 0;
+    size_t count;
+    while ((count = trace_reader_next_chunk(reader, entries, TRACE_CHUNK_ENTRIES)) > 0) {
+        records += count;
+        checksum += entries[count - 1].address;
+    }
+    close_trace_reader(reader);
+    b->records = records;
+    bench_sink += checksum;
+}
+
+static void bench_parse(const char* name, uint64_t (*write_trace)(FILE* file)) {
+    char mb_name[64], records_name[64];
+    snprintf(mb_name, sizeof(mb_name), "parse.%s", name);
+    snprintf(records_name, sizeof(records_name), "parse.%s.records", name);
+    if (!bench_selected(mb_name)) return;
+
+    char filename[] = "/tmp/cache_bench_XXXXXX";
+    int fd = mkstemp(filename);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!file) {
+        if (fd >= 0) close(fd);
+        bench_skip(mb_name, "could not create a temporary file");
+        return;
+    }
+    ParseBench b = { filename, write_trace(file), 0 };
+    bool written = fclose(file) == 0;
+
+    double seconds = written ? bench_best(parse_body, &b) : 0;
+    unlink(filename);
+    if (!written || b.records != PARSE_RECORDS) {
+        bench_skip(mb_name, "temporary trace did not read back");
+        return;
+    }
+    bench_report(mb_name, b.bytes / seconds / 1e6, "MB/s");
+    bench_report(records_name, b.records / seconds / 1e6, "Mrecords/s");
+}
+
+typedef struct {
+    const ControllerConfig* config;
+    const TraceEntry* entries;
+    size_t count;
+    uint32_t repeats;
+} ReplayBench;
+
+// Controller construction is part of each run but small next to the replay
+static void replay_basic_body(void* context) {
+    ReplayBench* b = (ReplayBench*)context;
+    CacheController* controller = create_cache_controller(b->config);
+    if (!controller) return;
+    for (uint32_t r = 0; r < b->repeats; r++) {
+        for (size_t i = 0; i < b->count; i++) simulate_trace_entry(controller, &b->entries[i]);
+    }
+    bench_sink += controller->L1->hits;
+    free_cache_controller(controller);
+}
+
+static void replay_enhanced_body(void* context) {
+    ReplayBench* b = (ReplayBench*)context;
+    EnhancedCacheController* controller = create_enhanced_controller(b->config);
+    if (!controller) return;
+    for (uint32_t r = 0; r < b->repeats; r++) {
+        for (size_t i = 0; i < b->count; i++) simulate_trace_entry_enhanced(controller, &b->entries[i]);
+    }
+    bench_sink += controller->L1->hits;
+    free_enhanced_controller(controller);
+}
+
+static void bench_replay(const char* name, const ControllerConfig* config,
+                         const TraceEntry* entries, size_t count, uint32_t repeats) {
+    char basic_name[64], enhanced_name[64];
+    snprintf(basic_name, sizeof(basic_name), "simulate.%s.basic", name);
+    snprintf(enhanced_name, sizeof(enhanced_name), "simulate.%s.enhanced", name);
+    ReplayBench b = { config, entries, count, repeats };
+    double accesses = (double)count * repeats;
+
+    if (bench_selected(basic_name)) {
+        bench_report(basic_name, accesses / bench_best(replay_basic_body, &b) / 1e6, "Maccesses/s");
+    }
+    if (bench_selected(enhanced_name)) {
+        bench_report(enhanced_name, accesses / bench_best(replay_enhanced_body, &b) / 1e6, "Maccesses/s");
+    }
+}
+
+static void bench_large_trace(const ControllerConfig* config) {
+    if (!bench_selected("simulate.test_large")) return;
+    TraceEntry* entries = NULL;
+    size_t count = 0;
+    if (access(LARGE_TRACE, R_OK) != 0 || read_usimm_trace(LARGE_TRACE, &entries, &count) != 0 ||
+        count == 0) {
+        bench_skip("simulate.test_large", LARGE_TRACE " not readable");
+        free(entries);
+        return;
+    }
+    bench_replay("test_large", config, entries, count, LARGE_TRACE_REPEATS);
+    free(entries);
+}
+
+/**
+ * The built-in workloads over 16MB with the default store ratio, generated
+ * into memory first so that only the simulation is timed: sequential is
+ * mostly L1 hits, random and pointer-chase mostly misses to memory, and
+ * zipf sits in between.
+ */
+static void bench_synthetic(const ControllerConfig* config) {
+    static const WorkloadPattern patterns[] = { WORKLOAD_SEQUENTIAL, WORKLOAD_RANDOM, WORKLOAD_ZIPF,
+                                                WORKLOAD_POINTER_CHASE };
+    TraceEntry* entries = (TraceEntry*)calloc(SYNTHETIC_RECORDS, sizeof(TraceEntry));
+    if (!entries) {
+        bench_skip("simulate.synthetic", "out of memory");
+        return;
+    }
+
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        const char* name = workload_pattern_name(patterns[p]);
+        WorkloadConfig workload;
+        default_workload_config(&workload);
+        workload.pattern = patterns[p];
+        workload.footprint = 16u << 20;
+        workload.accesses = SYNTHETIC_RECORDS;
+
+        WorkloadGenerator* generator = create_workload_generator(&workload);
+        if (!generator) {
+            bench_skip("simulate.synthetic", "could not create the workload");
+            continue;
+        }
+        uint32_t address;
+        bool is_write;
+        uint64_t random;
+        for (size_t i = 0; workload_next(generator, &address, &is_write, &random); i++) {
+            entries[i].op = is_write ? TRACE_STORE : TRACE_LOAD;
+            entries[i].address = address;
+            entries[i].size = WORKLOAD_ACCESS_SIZE;
+        }
+        free_workload_generator(generator);
+        bench_replay(name, config, entries, SYNTHETIC_RECORDS, 1);
+    }
+    free(entries);
+}
+
+void run_throughput_benchmarks(void) {
+    bench_parse("text", write_text_trace);
+    bench_parse("binary", write_binary_trace);
+
+    ControllerConfig config;
+    default_controller_config(&config);
+    bench_large_trace(&config);
+    bench_synthetic(&config);
+}
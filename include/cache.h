@@ -5,68 +5,158 @@
 
  #ifndef CACHE_H
  #define CACHE_H
- 
+
  #include <stdint.h>
  #include <stdbool.h>
- 
+
  // Cache Configuration Parameters
  #define ADDR_BITS       32
  #define BLOCK_OFFSET_BITS 6
- 
+ #define MAX_ASSOCIATIVITY 64
+
+ // Tag rows are padded to a multiple of this many ways so the SIMD
+ // compare never needs a scalar tail (8 x uint32_t = one AVX2 register)
+ #define TAG_ROW_ALIGN_WAYS 8
+
+ // Upper bound on the banks a cache can be split into
+ #define MAX_CACHE_BANKS 64
+
+ // Seed used when none is given, so every run is reproducible by default
+ #define DEFAULT_RANDOM_SEED 1
+
  typedef enum {
      LRU,
      RANDOM,
-     FIFO
+     FIFO,
+     PLRU,   // Tree pseudo-LRU (power-of-two associativity)
+     SRRIP,  // Static re-reference interval prediction
+     BRRIP,  // Bimodal RRIP: most fills predicted distant
+     DRRIP   // SRRIP/BRRIP chosen by set dueling
  } ReplacementPolicy;
- 
- /**
-  * Cache Line Structure
-  */
+
+ // Per-set counters behind the heat map
  typedef struct {
-    bool valid;
-    bool dirty;
-    uint32_t tag;
-    uint64_t last_access_time;
-    uint8_t data[]; // Flexible array member MUST be last
-} CacheLine;
- 
+     uint64_t accesses;
+     uint64_t misses;
+     uint64_t evictions;  // Valid lines chosen as replacement victims
+ } SetCounters;
+
+ struct MissClassifier;
+
  /**
   * Cache Structure
+  *
+  * Line metadata is kept as structure-of-arrays so the lookup path only
+  * touches a packed row of tags and one valid mask per set:
+  *   tags[set * way_stride + way]            tag of each way
+  *   valid_mask[set], dirty_mask[set],
+  *   prefetched_mask[set]                    one bit per way
+  *   age_rank[set * associativity + way]     LRU recency rank (0 = MRU)
+  *   repl_state[set * repl_words + ...]      FIFO pointer, PLRU tree or RRPV planes
+  *   data[(set * associativity + way) * block_size]
+  * A banked cache interleaves its sets over num_banks banks by the low
+  * index bits, so consecutive blocks fall in different banks.
+  * A dataless (tag-only) cache leaves `data` NULL and never copies blocks.
+  * read_kernel/write_kernel are picked by create_cache: common geometries
+  * get a version compiled with the way count and index width as constants.
   */
- typedef struct {
-     CacheLine** sets;
+ typedef struct Cache {
+     uint32_t* tags;
+     uint64_t* valid_mask;
+     uint64_t* dirty_mask;
+     uint64_t* prefetched_mask;   // Filled by a prefetch and not yet used by a demand access
+     uint8_t* age_rank;
+     uint64_t* repl_state;
+     uint32_t repl_words;
+     uint8_t* data;
+     uint32_t way_stride;
+     uint64_t full_mask;
+     bool (*read_kernel)(struct Cache* cache, uint32_t address, uint8_t* data);
+     bool (*write_kernel)(struct Cache* cache, uint32_t address, uint8_t* data);
+
      uint32_t num_sets;
      uint32_t associativity;
      uint32_t block_size;
      uint32_t index_bits;
      uint32_t tag_bits;
      ReplacementPolicy policy;
-     uint64_t access_counter;
-     
+     uint32_t psel;           // DRRIP selector: high means BRRIP is winning
+     uint64_t rng_seed;       // Seed of rng_state, reported with the statistics
+     uint64_t rng_state;      // xorshift64* state, private to this cache
+     uint32_t num_banks;      // Power of two; 1 for a monolithic array
+
      // Statistics
      uint64_t accesses;
      uint64_t hits;
      uint64_t misses;
      uint64_t write_backs;
+     uint64_t prefetch_hits;      // First demand hits on prefetched lines
+     uint64_t prefetch_unused;    // Prefetched lines evicted without a demand hit
+     bool last_hit_prefetched;    // The latest read/write hit a prefetched line
+     uint64_t* bank_accesses;     // Reads and writes per bank; NULL unless banked
+     SetCounters* set_stats;      // NULL unless per-set statistics are enabled
+     struct MissClassifier* classifier;  // 3C classification; NULL when off
  } Cache;
- 
+
  // Cache creation/destruction
- Cache* create_cache(uint32_t size, uint32_t block_size, uint32_t associativity, 
-                    uint32_t index_bits, uint32_t tag_bits, ReplacementPolicy policy);
+ Cache* create_cache(uint32_t size, uint32_t block_size, uint32_t associativity,
+                    uint32_t index_bits, uint32_t tag_bits, ReplacementPolicy policy,
+                    bool dataless);
  void free_cache(Cache* cache);
- 
+
+ // Split the sets over `banks` banks (a power of two no larger than the set count)
+ bool cache_set_banks(Cache* cache, uint32_t banks);
+
+ // Optional analysis, off by default since it adds work to every access
+ bool cache_enable_set_stats(Cache* cache);
+ bool cache_enable_miss_classes(Cache* cache);
+
+ static inline uint32_t cache_bank_of(const Cache* cache, uint32_t address) {
+     return (address >> BLOCK_OFFSET_BITS) & (cache->num_banks - 1);
+ }
+
+ // Per-cache random numbers (RANDOM victims, BRRIP/DRRIP insertion)
+ void cache_seed_random(Cache* cache, uint64_t seed);
+
+ static inline uint64_t cache_random(Cache* cache) {
+     uint64_t x = cache->rng_state;
+     x ^= x >> 12;
+     x ^= x << 25;
+     x ^= x >> 27;
+     cache->rng_state = x;
+     return x * 0x2545F4914F6CDD1DULL;
+ }
+
+ // Uniform value in [0, bound) without a division
+ static inline uint32_t cache_random_below(Cache* cache, uint32_t bound) {
+     return (uint32_t)(((cache_random(cache) >> 32) * bound) >> 32);
+ }
+
  // Core cache operations
  bool cache_read(Cache* cache, uint32_t address, uint8_t* data);
  bool cache_write(Cache* cache, uint32_t address, uint8_t* data);
- void cache_insert(Cache* cache, uint32_t address, uint8_t* data, bool is_dirty);
- 
+ // Returns the way that now holds the block
+ uint32_t cache_insert(Cache* cache, uint32_t address, uint8_t* data, bool is_dirty);
+
+ // Tag store access
+ int32_t cache_find_way(const Cache* cache, uint32_t set_index, uint32_t tag);
+ bool cache_set_full(const Cache* cache, uint32_t set_index);
+ bool cache_line_valid(const Cache* cache, uint32_t set_index, uint32_t way);
+ bool cache_line_dirty(const Cache* cache, uint32_t set_index, uint32_t way);
+ uint32_t cache_line_tag(const Cache* cache, uint32_t set_index, uint32_t way);
+ uint8_t* cache_line_data(Cache* cache, uint32_t set_index, uint32_t way);
+ bool cache_line_prefetched(const Cache* cache, uint32_t set_index, uint32_t way);
+ void cache_mark_prefetched(Cache* cache, uint32_t set_index, uint32_t way);
+ void cache_clean_line(Cache* cache, uint32_t set_index, uint32_t way);
+ void cache_invalidate_line(Cache* cache, uint32_t set_index, uint32_t way);
+
  // Address manipulation
  uint32_t get_tag(uint32_t address, uint32_t tag_bits, uint32_t index_bits);
  uint32_t get_index(uint32_t address, uint32_t index_bits);
  uint32_t get_offset(uint32_t address);
  uint32_t reconstruct_address(uint32_t tag, uint32_t index, uint32_t offset, uint32_t index_bits);
- 
+
  // Statistics
  void print_cache_stats(Cache* cache, const char* name);
- 
+
  #endif // CACHE_H
\ No newline at end of file
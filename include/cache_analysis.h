@@ -0,0 +1,56 @@
+/**
+ * cache_analysis.h
+ * 3C miss classification and per-set heat maps
+ *
+ * A miss is compulsory on the first touch of its block, a capacity miss
+ * if a fully-associative LRU cache of the same size would also miss, and
+ * a conflict miss otherwise. The shadow cache sees the same reads and
+ * writes as the real one, hits included.
+ */
+
+#ifndef CACHE_ANALYSIS_H
+#define CACHE_ANALYSIS_H
+
+#include "cache.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct MissClassifier {
+    // Shadow fully-associative LRU: slots on a doubly-linked list (head =
+    // most recent) and an open-addressing table from block to slot
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t* blocks;
+    uint32_t* prev;
+    uint32_t* next;
+    uint32_t head;
+    uint32_t tail;
+    int32_t* table;
+    uint32_t table_mask;
+    uint32_t table_shift;
+
+    uint64_t* seen;  // First-touch bitmap, one bit per block of the address space
+
+    // Statistics
+    uint64_t compulsory;
+    uint64_t capacity_misses;
+    uint64_t conflict;
+} MissClassifier;
+
+// `lines` is the capacity of the cache being classified, in blocks
+MissClassifier* create_miss_classifier(uint32_t lines);
+void free_miss_classifier(MissClassifier* classifier);
+
+// Feed one read or write of the real cache and classify it if it missed
+void classify_access(MissClassifier* classifier, uint32_t address, bool hit);
+
+void print_miss_classes(const MissClassifier* classifier);
+
+/**
+ * Write the per-set counters of `count` caches (each created with set
+ * statistics) as CSV rows: cache,set,accesses,misses,evictions,miss_rate
+ */
+bool write_set_heat_map(const char* filename, const Cache* const* caches, const char* const* names,
+                        uint32_t count);
+
+#endif // CACHE_ANALYSIS_H
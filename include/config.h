@@ -0,0 +1,38 @@
+/**
+ * config.h
+ * Runtime cache geometry and policy configuration
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "controller.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Parse "64", "32K" or "1M"
+bool parse_size_value(const char* text, uint32_t* value);
+
+/**
+ * Set a level's size, associativity and policy and derive its index bits.
+ * Fails (with a message) unless the set count is a power of two.
+ */
+bool configure_cache_level(CacheConfig* level, const char* name, uint32_t size,
+                           uint32_t associativity, ReplacementPolicy policy);
+
+/**
+ * Apply one "key value" setting, e.g. ("l1-size", "32K"). Keys match the
+ * long command-line options without the leading dashes. Returns false and
+ * prints why if the key or value is not valid.
+ */
+bool apply_config_option(ControllerConfig* config, const char* key, const char* value);
+
+// Read "key = value" lines ('#' starts a comment) from a config file
+bool load_config_file(ControllerConfig* config, const char* filename);
+
+// Re-derive index bits from size and associativity and check the result
+bool finalize_controller_config(ControllerConfig* config);
+
+void print_controller_config(const ControllerConfig* config);
+
+#endif // CONFIG_H
@@ -8,6 +8,12 @@
  
  #include "cache.h"
  #include "write_buffer.h"
+ #include "timing.h"
+ #include "mshr.h"
+ #include "prefetch.h"
+ #include "victim_cache.h"
+ #include "stats.h"
+ #include "workload.h"
  
  // Cache sizes
  #define L1_SIZE         (64*1024)
@@ -21,16 +27,87 @@
  #define L2_BLOCK_SIZE   64
  #define L2_ASSOCIATIVITY 16
  #define L2_SETS         (L2_SIZE/(L2_BLOCK_SIZE*L2_ASSOCIATIVITY))
- #define L2_INDEX_BITS   5
+ #define L2_INDEX_BITS   8
  #define L2_TAG_BITS     (ADDR_BITS - L2_INDEX_BITS - BLOCK_OFFSET_BITS)
+
+ // The index width must select exactly the sets each level has
+ static_assert(L1_SETS == 1 << L1_INDEX_BITS, "L1_INDEX_BITS does not match L1_SETS");
+ static_assert(L2_SETS == 1 << L2_INDEX_BITS, "L2_INDEX_BITS does not match L2_SETS");
+ 
+ /**
+  * Geometry and policy of one cache level (block size is fixed at
+  * 1 << BLOCK_OFFSET_BITS)
+  */
+ typedef struct {
+     uint32_t size;
+     uint32_t associativity;
+     uint32_t index_bits;
+     ReplacementPolicy policy;
+     uint32_t banks;     // Sets interleaved over this many banks (1 = monolithic)
+     bool classify_misses;  // Split misses into compulsory, capacity and conflict
+     bool set_stats;        // Keep per-set counters for a heat map
+ } CacheConfig;
+
+ /**
+  * How the contents of L1 (with its victim cache) relate to L2
+  */
+ typedef enum {
+     INCLUSION_NINE,       // Non-inclusive non-exclusive: fills go to both levels, evictions are independent
+     INCLUSION_INCLUSIVE,  // Every L1 block is in L2; L2 evictions back-invalidate L1
+     INCLUSION_EXCLUSIVE   // A block is in L1 or L2, never both; L1 victims move down to L2
+ } InclusionPolicy;
+ 
+ typedef struct {
+     uint64_t back_invalidations;        // L1 copies removed by L2 evictions (inclusive)
+     uint64_t dirty_back_invalidations;  // ...that held newer data, written to memory
+     uint64_t promotions;                // L2 hits moved up into L1 (exclusive)
+     uint64_t swaps;                     // Promotions that sent an L1 victim down in exchange
+     uint64_t demotions;                 // L1 victims placed in L2 (exclusive)
+ } InclusionStats;
  
+ /**
+  * Options fixed when a controller is built
+  */
+ typedef struct {
+     CacheConfig l1;
+     CacheConfig l2;
+     bool dataless;      // Track tags and state only; no block data is stored or copied
+     uint64_t seed;      // Random seed; L1 uses it as is, L2 uses seed + 1
+     uint32_t write_buffer_depth;  // Enhanced controller only
+     uint32_t write_buffer_drain;  // Occupancy above which the oldest entries drain
+     LatencyConfig latency;
+     uint32_t l1_mshrs;  // MSHR entries per level; 0 at both selects the blocking model
+     uint32_t l2_mshrs;
+     uint32_t l2_bank_busy;     // Cycles an L2 lookup occupies its bank; 0 = fully pipelined
+     PrefetcherKind l1_prefetch;
+     PrefetcherKind l2_prefetch;
+     uint32_t prefetch_degree;  // Blocks queued per trigger, shared by both levels
+     uint32_t victim_entries;   // Victim cache between L1 and L2; 0 for none
+     InclusionPolicy inclusion;
+     char heat_map[256];        // CSV file for the per-set counters; empty for none
+     char stats_file[256];      // Machine-readable statistics; empty for none
+     StatsFormat stats_format;
+     uint64_t stats_interval;   // Records between snapshots in stats_file; 0 for the final values only
+     uint64_t progress_interval;  // Records between progress lines; 0 for none
+     WorkloadConfig workload;     // Built-in workload, run when no trace file is given
+ } ControllerConfig;
+
  /**
   * Two-level Cache Controller
   */
  typedef struct {
      Cache* L1;
      Cache* L2;
+     bool dataless;
      uint64_t memory_accesses;
+     ServiceLevel last_service;  // Level that served the most recent operation
+     TimingStats timing;
+     MissPipeline pipeline;
+     Prefetcher* l1_prefetcher;  // NULL when the level does not prefetch
+     Prefetcher* l2_prefetcher;
+     VictimCache* victim_cache;  // NULL when disabled
+     InclusionPolicy inclusion;
+     InclusionStats inclusion_stats;
  } CacheController;
  
  /**
@@ -40,26 +117,51 @@
      Cache* L1;
      Cache* L2;
      WriteBuffer* write_buffer;
+     bool dataless;
      uint64_t memory_accesses;
+     ServiceLevel last_service;
+     TimingStats timing;
+     MissPipeline pipeline;
+     Prefetcher* l1_prefetcher;
+     Prefetcher* l2_prefetcher;
+     VictimCache* victim_cache;
+     InclusionPolicy inclusion;
+     InclusionStats inclusion_stats;
  } EnhancedCacheController;
  
- // Controller creation/destruction
- CacheController* create_cache_controller();
+ // Controller creation/destruction (a NULL config selects the defaults)
+ void default_controller_config(ControllerConfig* config);
+ CacheController* create_cache_controller(const ControllerConfig* config);
  void free_cache_controller(CacheController* controller);
- EnhancedCacheController* create_enhanced_controller();
+ EnhancedCacheController* create_enhanced_controller(const ControllerConfig* config);
  void free_enhanced_controller(EnhancedCacheController* controller);
  
- // Multi-level operations
+ // One cache level built from a CacheConfig, its random generator seeded with `seed`
+ Cache* create_cache_level(const CacheConfig* level, bool dataless, uint64_t seed);
+ 
+ // Multi-level operations; each is charged to controller->timing
  bool controller_read(CacheController* controller, uint32_t address, uint8_t* data);
  bool controller_write(CacheController* controller, uint32_t address, uint8_t* data);
  bool enhanced_read(EnhancedCacheController* controller, uint32_t address, uint8_t* data);
  bool enhanced_write(EnhancedCacheController* controller, uint32_t address, uint8_t* data);
  
+ // Drain every buffered store into the hierarchy (e.g. at the end of a trace)
+ void drain_write_buffer(EnhancedCacheController* controller);
+ 
+ const char* inclusion_policy_name(InclusionPolicy inclusion);
+ bool parse_inclusion_policy(const char* name, InclusionPolicy* inclusion);
+ 
  // Eviction handling
  void handle_eviction(CacheController* controller, Cache* cache, uint32_t set_index, uint32_t way);
  
  // Statistics
+ // Per-bank L2 accesses, plus conflicts when `pipeline` models bank occupancy (may be NULL)
+ void print_l2_bank_stats(const Cache* l2, const MissPipeline* pipeline);
  void print_controller_stats(CacheController* controller);
  void print_enhanced_stats(EnhancedCacheController* controller);
  
+ // Register every counter of a controller and its components; false if out of memory
+ bool register_controller_stats(StatsRegistry* registry, CacheController* controller);
+ bool register_enhanced_stats(StatsRegistry* registry, EnhancedCacheController* controller);
+ 
  #endif // CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+/**
+ * mshr.h
+ * Miss status holding registers and the non-blocking issue model
+ */
+
+#ifndef MSHR_H
+#define MSHR_H
+
+#include "timing.h"
+#include "cache.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define L1_MSHR_ENTRIES 8
+#define L2_MSHR_ENTRIES 16
+#define MAX_MSHR_ENTRIES 64
+
+typedef struct {
+    uint32_t block_address;
+    uint64_t ready_cycle;   // Cycle at which the block arrives
+    bool prefetch;          // Allocated by a prefetch no demand access has merged into yet
+} MshrEntry;
+
+/**
+ * One level's MSHR file. Entries are searched associatively, as the
+ * hardware CAM would be; files are small enough that a scan is cheapest.
+ */
+typedef struct {
+    MshrEntry entries[MAX_MSHR_ENTRIES];
+    uint32_t capacity;
+    uint32_t count;
+
+    // Statistics
+    uint64_t allocations;     // Primary misses
+    uint64_t merges;          // Secondary misses folded into an in-flight entry
+    uint64_t full_stalls;     // Primary misses that found the file full
+    uint64_t prefetches;      // Entries allocated by prefetches
+    uint64_t late_prefetches; // Demand accesses that merged into an in-flight prefetch
+    uint64_t stall_cycles;
+    uint64_t busy_cycles;     // Sum of entry lifetimes (for average occupancy)
+    uint32_t peak_occupancy;
+} MshrFile;
+
+/**
+ * L2 bank occupancy. Each L2 lookup on the miss path holds its bank for
+ * busy_cycles; a lookup that finds the bank still busy waits for it (a
+ * bank conflict). busy_cycles 0 leaves the L2 fully pipelined.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t busy_cycles;
+    uint64_t free_at[MAX_CACHE_BANKS];
+    uint64_t conflicts[MAX_CACHE_BANKS];
+    uint64_t stall_cycles[MAX_CACHE_BANKS];
+} BankPorts;
+
+/**
+ * Non-blocking issue model: one operation issues per cycle, hits are
+ * pipelined, primary misses take an MSHR and later accesses to the same
+ * block wait only for the remaining fill time. Issue stalls only when a
+ * needed MSHR file is full. Without MSHR files every operation blocks.
+ */
+typedef struct {
+    MshrFile* l1;
+    MshrFile* l2;
+    uint64_t now;      // Issue cycle of the next operation
+    uint64_t finish;   // Latest completion so far
+    BankPorts banks;
+} MissPipeline;
+
+// A pipeline with zero-entry files is blocking and allocates nothing
+bool init_miss_pipeline(MissPipeline* pipeline, uint32_t l1_entries, uint32_t l2_entries,
+                        uint32_t l2_banks, uint32_t bank_busy_cycles);
+void free_miss_pipeline(MissPipeline* pipeline);
+
+static inline bool miss_pipeline_enabled(const MissPipeline* pipeline) {
+    return pipeline->l1 != NULL;
+}
+
+// Issue one operation that the functional model served at `level`; returns its latency
+uint32_t miss_pipeline_issue(MissPipeline* pipeline, const LatencyConfig* latency,
+                             uint32_t block_address, ServiceLevel level);
+
+/**
+ * Start a prefetch of `block_address` into L1 (from L2 or memory) or into
+ * L2 (from memory) at the current cycle. Prefetches take a free MSHR but
+ * never stall issue; returns false, and allocates nothing, if none is free.
+ */
+bool miss_pipeline_prefetch(MissPipeline* pipeline, const LatencyConfig* latency,
+                            uint32_t block_address, bool into_l1, ServiceLevel source);
+
+// Cycles from the first issue until every outstanding miss has completed
+uint64_t miss_pipeline_cycles(const MissPipeline* pipeline);
+
+void print_mshr_stats(const MissPipeline* pipeline);
+
+#endif // MSHR_H
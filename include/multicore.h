@@ -0,0 +1,87 @@
+/**
+ * multicore.h
+ * Multi-core simulation: private L1s kept coherent with MESI, shared L2
+ *
+ * Each trace file drives one core. Cores snoop a shared bus: a read miss
+ * (BusRd) makes an E or M owner supply the block and drop to S, an M
+ * owner also writing it back to L2; a write miss (BusRdX) or a write to
+ * an S line (upgrade) invalidates every other copy. Line state is kept as
+ * bit masks next to the L1 tag store:
+ *   I = not valid, S = valid, E = valid + exclusive, M = E + dirty
+ * The shared L2 is non-inclusive, as in the single-core controller.
+ */
+
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include "controller.h"
+#include "trace_parser.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MULTICORE_MAX_CORES 16
+
+typedef enum {
+    INTERLEAVE_ROUND_ROBIN,  // One record per core in turn
+    INTERLEAVE_TIMESTAMP     // The core whose local clock is furthest behind goes next
+} InterleavePolicy;
+
+typedef struct {
+    Cache* l1;
+    uint64_t* exclusive_mask;   // Per set: lines in E or M
+    uint64_t* coherence_mask;   // Per set: invalid lines whose block another core took
+
+    // Trace input
+    const char* trace_name;
+    TraceReader* reader;
+    TraceEntry* chunk;
+    size_t chunk_length;
+    size_t chunk_pos;
+    bool finished;
+    uint64_t records;
+
+    TimingStats timing;         // Blocking model; cycles is the core's local clock
+
+    // Coherence statistics
+    uint64_t invalidations;     // Lines lost to another core's write
+    uint64_t interventions;     // Blocks supplied to another core's miss
+    uint64_t upgrades;          // Writes to S lines that invalidated the other copies
+    uint64_t coherence_misses;  // Misses on a block lost to an invalidation
+} Core;
+
+typedef struct {
+    Core* cores;
+    uint32_t num_cores;
+    Cache* L2;
+    bool dataless;
+    InterleavePolicy interleave;
+    uint64_t memory_accesses;
+
+    // Bus transactions
+    uint64_t bus_reads;
+    uint64_t bus_read_exclusives;
+    uint64_t bus_upgrades;
+} MultiCoreSystem;
+
+const char* interleave_policy_name(InterleavePolicy interleave);
+bool parse_interleave_policy(const char* name, InterleavePolicy* interleave);
+
+/**
+ * Build `num_cores` cores with config->l1 each and one config->l2. Only
+ * the cache geometry, policies, latencies, seed and dataless flag apply.
+ */
+MultiCoreSystem* create_multicore_system(const ControllerConfig* config, uint32_t num_cores,
+                                         InterleavePolicy interleave);
+void free_multicore_system(MultiCoreSystem* system);
+
+// One access by `core`; returns true on an L1 hit
+bool multicore_read(MultiCoreSystem* system, uint32_t core, uint32_t address, uint8_t* data);
+bool multicore_write(MultiCoreSystem* system, uint32_t core, uint32_t address, uint8_t* data);
+
+// Replay trace file i on core i, interleaved; returns 0 on success (`run` may be NULL)
+int process_multicore_traces(MultiCoreSystem* system, const char* const* filenames, TraceRun* run);
+
+void print_multicore_stats(const MultiCoreSystem* system);
+bool register_multicore_stats(StatsRegistry* registry, MultiCoreSystem* system);
+
+#endif // MULTICORE_H
@@ -0,0 +1,36 @@
+/**
+ * parallel.h
+ * Set-sharded parallel simulation of a single configuration
+ *
+ * The L1 and L2 index fields both start at BLOCK_OFFSET_BITS, so the low
+ * min(L1, L2) index bits of a block address pick the same shard at both
+ * levels, and write-backs from L1 land in an L2 set of the same shard.
+ * Each shard therefore sees exactly the accesses and evictions of its own
+ * sets in trace order, and summing the per-shard counters reproduces the
+ * serial run bit for bit. Policies with per-cache random state would
+ * diverge, so main rejects -p for them.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "controller.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Records per batch handed to a shard, and batches in flight per shard
+#define SHARD_BATCH_ENTRIES 4096
+#define SHARD_QUEUE_DEPTH   8
+
+// Largest shard count the configuration can be split into (a power of two)
+uint32_t max_trace_shards(const ControllerConfig* config);
+
+/**
+ * Replay the trace files in order across `shards` worker threads and
+ * accumulate the merged statistics into `merged`, which must have been
+ * created with the same configuration. Returns 0 on success.
+ */
+int process_usimm_trace_sharded(CacheController* merged, const ControllerConfig* config,
+                                const char* const* filenames, int num_files, uint32_t shards);
+
+#endif // PARALLEL_H
@@ -0,0 +1,69 @@
+/**
+ * prefetch.h
+ * Hardware prefetchers (next-line, stride, stream)
+ *
+ * A prefetcher watches the demand accesses of one cache level and queues
+ * candidate blocks; the controller issues them once the demand access is
+ * done. Filled lines carry a prefetched bit in the cache until their first
+ * demand hit (useful) or eviction (unused).
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "cache.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PREFETCH_DEFAULT_DEGREE 2
+#define PREFETCH_MAX_DEGREE     8
+#define STRIDE_TABLE_ENTRIES    64   // Direct-mapped, one entry per 4KB region
+#define STREAM_TRACKERS         16
+#define STREAM_WINDOW           16   // Blocks a miss may be from a stream's head
+
+typedef enum {
+    PREFETCH_NONE,
+    PREFETCH_NEXT_LINE,  // Tagged next-line: on a miss or first use of a prefetched line
+    PREFETCH_STRIDE,     // Per-region stride detection with 2-bit confidence
+    PREFETCH_STREAM      // Ascending/descending miss streams, run ahead by `degree`
+} PrefetcherKind;
+
+typedef struct Prefetcher {
+    PrefetcherKind kind;
+    uint32_t degree;
+    void (*observe)(struct Prefetcher* pf, uint32_t block, bool miss, bool prefetch_hit);
+    void* state;
+
+    // Candidate block numbers (address >> BLOCK_OFFSET_BITS) awaiting issue
+    uint32_t pending[PREFETCH_MAX_DEGREE];
+    uint32_t num_pending;
+
+    // Statistics
+    uint64_t issued;          // Candidates produced
+    uint64_t redundant;       // Already cached at this level
+    uint64_t dropped;         // No MSHR free to fetch it
+    uint64_t fills;
+    uint64_t memory_fetches;  // Fills that went to memory (extra traffic)
+    uint64_t displaced;       // Valid demand-fetched lines evicted by a fill
+} Prefetcher;
+
+// NULL for PREFETCH_NONE (prefetching off) or on allocation failure
+Prefetcher* create_prefetcher(PrefetcherKind kind, uint32_t degree);
+void free_prefetcher(Prefetcher* pf);
+
+// Train on one demand access; may queue candidates in pf->pending
+static inline void prefetcher_observe(Prefetcher* pf, uint32_t address, bool miss, bool prefetch_hit) {
+    if (pf) pf->observe(pf, address >> BLOCK_OFFSET_BITS, miss, prefetch_hit);
+}
+
+const char* prefetcher_name(PrefetcherKind kind);
+bool parse_prefetcher(const char* name, PrefetcherKind* kind);
+
+/**
+ * Print accuracy (useful / fills), coverage (useful / (useful + demand
+ * misses)) and, when `late` is known, timeliness
+ */
+void print_prefetch_stats(const char* name, const Prefetcher* pf, uint64_t useful, uint64_t unused,
+                          uint64_t demand_misses, bool have_timing, uint64_t late);
+
+#endif // PREFETCH_H
@@ -0,0 +1,84 @@
+/**
+ * profile.h
+ * Optional self-profiling of the simulator's hot paths
+ *
+ * Built with CACHE_PROFILE defined (make PROFILE=1), each instrumented
+ * function adds its call count and elapsed time-stamp-counter cycles to
+ * counters private to the calling thread. A thread's counters are folded
+ * into the process totals when it exits, and the totals print to stderr
+ * when the process exits. Times are inclusive: cache_insert's cycles
+ * include the get_victim_way calls it makes.
+ *
+ * Without CACHE_PROFILE, PROFILE_SCOPE expands to nothing.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#ifdef CACHE_PROFILE
+
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+typedef enum {
+    PROFILE_CACHE_READ,
+    PROFILE_CACHE_WRITE,
+    PROFILE_CACHE_INSERT,
+    PROFILE_GET_VICTIM_WAY,
+    PROFILE_EVICT_L1,  // Evictions of both controllers (handle_eviction and the enhanced paths)
+    PROFILE_EVICT_L2,
+    PROFILE_CHECK_WRITE_BUFFER,
+    PROFILE_INSERT_WRITE_BUFFER,
+    PROFILE_WRITE_BUFFER_POP,
+    PROFILE_TRACE_PARSE,
+    PROFILE_POINTS
+} ProfilePoint;
+
+typedef struct {
+    uint64_t calls[PROFILE_POINTS];
+    uint64_t cycles[PROFILE_POINTS];
+    bool registered;  // Set once the thread-exit hook knows about these counters
+} ProfileCounters;
+
+extern __thread ProfileCounters profile_counters;
+
+// Arrange for this thread's counters to reach the totals when it exits
+void profile_register_thread(void);
+
+static inline uint64_t profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Times the enclosing block from its declaration to every exit from it
+struct ProfileScope {
+    ProfilePoint point;
+    uint64_t start;
+
+    explicit ProfileScope(ProfilePoint p) : point(p), start(profile_clock()) {}
+    ~ProfileScope() {
+        ProfileCounters* counters = &profile_counters;
+        if (!counters->registered) profile_register_thread();
+        counters->calls[point]++;
+        counters->cycles[point] += profile_clock() - start;
+    }
+};
+
+#define PROFILE_SCOPE(point) ProfileScope profile_scope_(point)
+
+#else
+
+#define PROFILE_SCOPE(point)
+
+#endif // CACHE_PROFILE
+
+#endif // PROFILE_H
@@ -1,14 +1,80 @@
 /**
  * replacement.h
  * Replacement policies implementation
+ *
+ * Every policy keeps a few bits of state per way or per set:
+ *   LRU    one recency rank byte per way (ranks form a permutation)
+ *   FIFO   one insertion pointer per set
+ *   PLRU   associativity - 1 tree bits per set
+ *   RRIP   a 2-bit re-reference prediction value per way, stored as two
+ *          bit planes per set so the victim search is a mask and a ctz
  */
 
  #ifndef REPLACEMENT_H
  #define REPLACEMENT_H
  
  #include "cache.h"
+ #include <string.h>
+ 
+ #define RRPV_MAX 3
+ #define DRRIP_PSEL_BITS 10
+ #define DRRIP_MAX_LEADERS 32   // Leader sets per policy in large caches
+ #define DRRIP_MIN_SETS 4       // Fewer sets leave no followers: DRRIP runs as SRRIP
+ #define BRRIP_LONG_INTERVAL 32  // BRRIP inserts 1 in 32 fills (at random) at RRPV_MAX - 1
+ 
+ // Allocate and reset the policy state of a freshly created cache
+ bool init_replacement_state(Cache* cache);
  
  // Replacement policy implementations
  uint32_t get_victim_way(Cache* cache, uint32_t set_index);
+ void replacement_on_fill(Cache* cache, uint32_t set_index, uint32_t way);
+ 
+ // Move `way` to the most-recently-used rank
+ static inline void lru_promote(uint8_t* ranks, uint32_t associativity, uint32_t way) {
+     uint8_t rank = ranks[way];
+     for (uint32_t i = 0; i < associativity; i++) {
+         ranks[i] += ranks[i] < rank;
+     }
+     ranks[way] = 0;
+ }
+ 
+ // Point every tree node on the path to `way` away from it
+ static inline void plru_promote(uint64_t* tree, uint32_t associativity, uint32_t way) {
+     uint64_t bits = *tree;
+     for (uint32_t node = way + associativity; node > 1; node >>= 1) {
+         uint64_t parent = 1ULL << (node >> 1);
+         if (node & 1) bits &= ~parent;  // came from the right: victim goes left
+         else bits |= parent;
+     }
+     *tree = bits;
+ }
+ 
+ static inline void replacement_on_hit(Cache* cache, uint32_t set_index, uint32_t way) {
+     switch (cache->policy) {
+         case LRU:
+             lru_promote(&cache->age_rank[(size_t)set_index * cache->associativity],
+                         cache->associativity, way);
+             break;
+         case PLRU:
+             plru_promote(&cache->repl_state[set_index], cache->associativity, way);
+             break;
+         case SRRIP:
+         case BRRIP:
+         case DRRIP: {
+             // Hit promotion: predict a near re-reference (RRPV 0)
+             uint64_t* planes = &cache->repl_state[(size_t)set_index * 2];
+             planes[0] &= ~(1ULL << way);
+             planes[1] &= ~(1ULL << way);
+             break;
+         }
+         case RANDOM:
+         case FIFO:
+             break;
+     }
+ }
+ 
+ // Policy names as used on the command line ("lru", "random", ...)
+ const char* replacement_policy_name(ReplacementPolicy policy);
+ bool parse_replacement_policy(const char* name, ReplacementPolicy* policy);
  
- #endif // REPLACEMENT_H
\ No newline at end of file
+ #endif // REPLACEMENT_H
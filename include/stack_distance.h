@@ -0,0 +1,71 @@
+/**
+ * stack_distance.h
+ * Single-pass LRU stack-distance (Mattson) analysis
+ *
+ * For every power-of-two set count up to 2^SD_MAX_INDEX_BITS, using the
+ * simulator's block size and get_index mapping, each access records the
+ * number of distinct blocks touched in its set since the previous access
+ * to the same block. An LRU cache with A ways then hits exactly when that
+ * distance is below A, so one pass gives miss counts for every size and
+ * associativity.
+ */
+
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include "cache.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SD_MAX_INDEX_BITS 14
+#define SD_MAX_WAYS       MAX_ASSOCIATIVITY
+
+/**
+ * Per-set LRU stack. Accesses are numbered with a per-set clock; a Fenwick
+ * tree over the clock marks the latest access of each resident block, so
+ * a stack distance is one prefix-sum difference. owner[] maps a clock value
+ * back to its block so the stack can be compacted when the clock runs out.
+ */
+typedef struct {
+    int32_t* fenwick;
+    uint32_t* owner;        // block + 1, or 0 if that access is superseded
+    uint32_t capacity;
+    uint32_t clock;
+    uint32_t live;
+} SDSet;
+
+/**
+ * Analysis for one set count: last-access clock of every block seen, the
+ * per-set stacks and the distance histogram.
+ */
+typedef struct {
+    uint32_t index_bits;
+    uint32_t num_sets;
+    SDSet* sets;
+
+    // Open-addressing map: block + 1 -> last per-set clock
+    uint32_t* keys;
+    uint32_t* times;
+    uint32_t map_capacity;
+    uint32_t map_size;
+
+    uint64_t histogram[SD_MAX_WAYS];  // hits for distance d
+    uint64_t far_accesses;            // distance >= SD_MAX_WAYS
+    uint64_t cold_misses;
+} SDConfig;
+
+typedef struct {
+    SDConfig configs[SD_MAX_INDEX_BITS + 1];
+    uint64_t accesses;
+} StackDistanceProfile;
+
+StackDistanceProfile* create_stack_distance_profile();
+void free_stack_distance_profile(StackDistanceProfile* profile);
+
+void stack_distance_access(StackDistanceProfile* profile, uint32_t address);
+
+// Misses of an LRU cache with 2^index_bits sets and `ways` ways
+uint64_t stack_distance_misses(const StackDistanceProfile* profile, uint32_t index_bits, uint32_t ways);
+void print_stack_distance_report(const StackDistanceProfile* profile);
+
+#endif // STACK_DISTANCE_H
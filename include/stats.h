@@ -0,0 +1,66 @@
+/**
+ * stats.h
+ * Statistics registry with JSON/CSV output and interval snapshots
+ *
+ * Components register pointers to their own uint64_t counters under
+ * dotted names ("l1.hits", "mshr.l2.merges"); nothing is copied until a
+ * snapshot or the final dump reads them. Snapshots are cumulative, so a
+ * phase is the difference between two consecutive rows. Output streams
+ * to the file as the run goes:
+ *   JSON  {"intervals": [{"records": N, ...}, ...], "final": {...}}
+ *   CSV   kind,records,<name>... with one "interval" row per snapshot
+ *         and a last "final" row
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "cache.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STATS_NAME_LENGTH 64
+
+typedef enum {
+    STATS_JSON,
+    STATS_CSV
+} StatsFormat;
+
+typedef struct {
+    char name[STATS_NAME_LENGTH];
+    const uint64_t* value;
+} StatEntry;
+
+typedef struct {
+    StatEntry* entries;
+    uint32_t count;
+    uint32_t capacity;
+
+    StatsFormat format;
+    FILE* file;
+    const char* filename;
+    uint64_t interval;   // Records between snapshots; 0 for the final dump only
+    uint64_t snapshots;
+} StatsRegistry;
+
+const char* stats_format_name(StatsFormat format);
+bool parse_stats_format(const char* name, StatsFormat* format);
+
+// Opens `filename` for writing; NULL (with a message) on failure
+StatsRegistry* create_stats_registry(const char* filename, StatsFormat format, uint64_t interval);
+void free_stats_registry(StatsRegistry* registry);
+
+// Register `value` as "<prefix>.<name>" (or just `name` with an empty prefix)
+bool stats_register(StatsRegistry* registry, const char* prefix, const char* name, const uint64_t* value);
+
+// Counters every Cache keeps, plus its optional miss classes and banks
+bool stats_register_cache(StatsRegistry* registry, const char* prefix, const Cache* cache);
+
+// Append a snapshot of every counter after `records` trace records
+void stats_snapshot(StatsRegistry* registry, uint64_t records);
+
+// Write the final values and close the file; returns false on a write error
+bool stats_finish(StatsRegistry* registry, uint64_t records);
+
+#endif // STATS_H
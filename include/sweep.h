@@ -0,0 +1,65 @@
+/**
+ * sweep.h
+ * Multi-threaded design-space sweep over a shared in-memory trace
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "controller.h"
+#include "trace_parser.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SWEEP_MAX_VALUES 16
+
+/**
+ * Value lists for each swept dimension; every combination becomes a job
+ */
+typedef struct {
+    uint32_t l1_sizes[SWEEP_MAX_VALUES];
+    uint32_t l1_assocs[SWEEP_MAX_VALUES];
+    uint32_t l2_sizes[SWEEP_MAX_VALUES];
+    uint32_t l2_assocs[SWEEP_MAX_VALUES];
+    ReplacementPolicy policies[SWEEP_MAX_VALUES];
+    bool write_buffer[2];
+    uint32_t num_l1_sizes, num_l1_assocs, num_l2_sizes, num_l2_assocs;
+    uint32_t num_policies, num_write_buffer;
+    uint32_t threads;       // 0 = one per online CPU
+    uint64_t seed;          // Same seed for every job, so results are reproducible
+} SweepGrid;
+
+/**
+ * One configuration and, once run, its statistics
+ */
+typedef struct {
+    ControllerConfig config;
+    bool write_buffer;
+
+    bool done;
+    uint64_t l1_accesses, l1_misses, l1_write_backs;
+    uint64_t l2_accesses, l2_misses, l2_write_backs;
+    uint64_t wb_write_backs;
+    uint64_t memory_accesses;
+    double amat;
+} SweepJob;
+
+void default_sweep_grid(SweepGrid* grid);
+
+// Parse a sweep option ("--l1-sizes 32K,64K" etc.); returns arguments consumed, 0 if unknown, -1 on error
+int parse_sweep_option(SweepGrid* grid, int argc, char** argv, int index);
+
+// Expand the grid into jobs; invalid geometries are reported and skipped
+SweepJob* build_sweep_jobs(const SweepGrid* grid, size_t* num_jobs);
+
+// Run every job against the shared read-only trace on a work-stealing pool
+void run_sweep(const TraceEntry* trace, size_t trace_length, SweepJob* jobs, size_t num_jobs,
+               uint32_t threads);
+
+void print_sweep_table(const SweepJob* jobs, size_t num_jobs);
+
+// Entry point for "cache_simulator sweep [options] <trace_file...>"
+int sweep_main(int argc, char** argv);
+
+#endif // SWEEP_H
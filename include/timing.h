@@ -0,0 +1,75 @@
+/**
+ * timing.h
+ * Latency model: per-level service latencies, cycles and AMAT
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Default latencies in cycles
+#define L1_HIT_LATENCY       4
+#define L2_HIT_LATENCY       12
+#define WRITE_BUFFER_LATENCY 1
+#define VICTIM_CACHE_LATENCY 2
+#define MEMORY_LATENCY       200
+
+// Histogram bucket b counts latencies in [2^(b-1), 2^b), bucket 0 is 0 cycles
+#define TIMING_HISTOGRAM_BUCKETS 16
+
+/**
+ * Where an operation was satisfied. Each level's latency is paid on top
+ * of the levels looked up before it (L1, then L2, then memory); the
+ * write buffer is probed alongside L1 and answers on its own, and the
+ * victim cache is probed after an L1 miss, in parallel with L2.
+ */
+typedef enum {
+    SERVICE_WRITE_BUFFER,
+    SERVICE_L1,
+    SERVICE_VICTIM,
+    SERVICE_L2,
+    SERVICE_MEMORY,
+    SERVICE_LEVELS
+} ServiceLevel;
+
+typedef struct {
+    uint32_t l1;
+    uint32_t l2;
+    uint32_t write_buffer;
+    uint32_t victim;
+    uint32_t memory;
+} LatencyConfig;
+
+typedef struct {
+    LatencyConfig latency;
+
+    uint64_t cycles;          // Elapsed cycles
+    uint64_t read_ops, write_ops;
+    uint64_t read_cycles, write_cycles;
+    uint64_t served[SERVICE_LEVELS];
+    uint64_t histogram[TIMING_HISTOGRAM_BUCKETS];
+} TimingStats;
+
+void default_latency_config(LatencyConfig* latency);
+void init_timing_stats(TimingStats* timing, const LatencyConfig* latency);
+
+// Latency of an operation satisfied at `level`
+uint32_t service_latency(const LatencyConfig* latency, ServiceLevel level);
+
+// Account one operation of `latency` cycles (the caller owns `cycles`,
+// which is elapsed time and only equals the sum of latencies when blocking)
+void timing_record(TimingStats* timing, bool is_write, ServiceLevel level, uint32_t latency);
+
+// Add the counters of `part` (same latencies) into `total`
+void merge_timing_stats(TimingStats* total, const TimingStats* part);
+
+// Average memory access time: mean latency over all operations
+double timing_amat(const TimingStats* timing);
+
+const char* service_level_name(ServiceLevel level);
+// The victim latency is listed only when a victim cache is configured
+void print_timing_stats(const TimingStats* timing, bool victim_cache);
+
+#endif // TIMING_H
@@ -0,0 +1,42 @@
+/**
+ * trace_binary.h
+ * Compact binary trace format
+ *
+ * Layout: a 16-byte header ("USIMMTB1" followed by the little-endian
+ * uint64_t record count, or BINARY_TRACE_UNKNOWN_COUNT when the writer
+ * could not seek back to fill it in), then one record per access:
+ *   byte 0    bits 0-1 op, bits 2-5 size (15 = size follows as a varint),
+ *             bit 6 payload present
+ *   varint    zigzag-encoded address delta from the previous record
+ *   [varint]  size, only when the inline field is 15
+ *   [payload] min(size, 8) data bytes, only when bit 6 is set
+ */
+
+#ifndef TRACE_BINARY_H
+#define TRACE_BINARY_H
+
+#include "trace_parser.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BINARY_TRACE_MAGIC        "USIMMTB1"
+#define BINARY_TRACE_MAGIC_SIZE   8
+#define BINARY_TRACE_HEADER_SIZE  16
+#define BINARY_TRACE_MAX_RECORD   19
+#define BINARY_TRACE_UNKNOWN_COUNT UINT64_MAX
+
+// Header handling
+bool is_binary_trace(const void* bytes, size_t length);
+uint64_t binary_trace_record_count(const void* header);
+void write_binary_trace_header(uint8_t* header, uint64_t record_count);
+
+// Record coding; both return the number of bytes used (0 = incomplete input)
+size_t encode_binary_record(const TraceEntry* entry, uint32_t* prev_address, uint8_t* out);
+size_t decode_binary_record(const uint8_t* p, const uint8_t* end, uint32_t* prev_address,
+                            TraceEntry* entry);
+
+// Convert any readable trace (text, binary, "-") into the binary format
+int convert_trace_to_binary(const char* input, const char* output);
+
+#endif // TRACE_BINARY_H
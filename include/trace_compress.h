@@ -0,0 +1,40 @@
+/**
+ * trace_compress.h
+ * Compressed trace input decoded on a background thread
+ */
+
+#ifndef TRACE_COMPRESS_H
+#define TRACE_COMPRESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef enum {
+    TRACE_UNCOMPRESSED,
+    TRACE_GZIP,
+    TRACE_ZSTD
+} TraceCompression;
+
+// Decompressed data is handed over in blocks of this size through a
+// bounded queue, so the decoder runs at most this far ahead of the parser
+#define DECOMPRESS_BLOCK_SIZE   (256 * 1024)
+#define DECOMPRESS_QUEUE_BLOCKS 8
+
+typedef struct CompressedStream CompressedStream;
+
+// Detect the format from the first bytes of the input (at least 4)
+#define TRACE_MAGIC_PEEK 4
+TraceCompression detect_trace_compression(const void* head, size_t length);
+bool trace_compression_supported(TraceCompression kind);
+const char* trace_compression_name(TraceCompression kind);
+
+// The stream takes over reading `fd`; the caller still owns and closes it.
+// `prefix` holds bytes already consumed from a pipe while peeking the magic.
+CompressedStream* open_compressed_stream(int fd, TraceCompression kind,
+                                         const void* prefix, size_t prefix_length);
+ssize_t compressed_stream_read(CompressedStream* stream, void* buf, size_t len);
+void close_compressed_stream(CompressedStream* stream);
+
+#endif // TRACE_COMPRESS_H
@@ -7,8 +7,11 @@
 #define TRACE_PARSER_H
 
 #include "controller.h"
+#include "trace_compress.h"
+#include "stack_distance.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef enum {
     TRACE_INSTRUCTION,
@@ -24,9 +27,77 @@ typedef struct {
     uint8_t data[8];  // Maximum 8 bytes of data
 } TraceEntry;
 
+// Records handed out per call to trace_reader_next_chunk by the trace loops
+#define TRACE_CHUNK_ENTRIES 4096
+
+/**
+ * Streaming trace reader. Regular files are mapped and parsed in place;
+ * "-" (stdin), FIFOs and other non-seekable inputs are read through a
+ * fixed-size buffer; gzip/zstd input is decompressed on a background
+ * thread into that buffer. Memory use is constant in the trace length. Text
+ * (USIMM) and binary traces are told apart by the header and decoded
+ * by the matching parser.
+ */
+typedef struct {
+    int fd;
+    bool owns_fd;
+
+    // Mapped input (regular files)
+    const char* map;
+    size_t map_length;
+    size_t map_pos;
+    size_t map_released;
+
+    // Buffered input (pipes, stdin, compressed files)
+    CompressedStream* stream;
+    char* buffer;
+    size_t buffer_capacity;
+    size_t buffer_start;
+    size_t buffer_end;
+    bool eof;
+
+    // Binary traces (see trace_binary.h) are detected from their header
+    bool binary;
+    uint32_t last_address;
+    uint64_t declared_records;  // From the header; checked against `records` at the end
+    bool count_checked;
+
+    uint64_t records;
+} TraceReader;
+
+// Streaming interface
+TraceReader* open_trace_reader(const char* filename);
+size_t trace_reader_next_chunk(TraceReader* reader, TraceEntry* entries, size_t max_entries);
+void close_trace_reader(TraceReader* reader);
+
+/**
+ * Reporting while traces are replayed. `records` counts across every file
+ * of a run; a zero interval (or NULL stats) turns that report off.
+ */
+typedef struct {
+    uint64_t progress_interval;  // Records between "Processed N entries" lines
+    StatsRegistry* stats;        // Snapshot every stats->interval records
+    uint64_t records;            // Records replayed so far
+} TraceRun;
+
+// Record count at which `run` next has something to report; UINT64_MAX for never (or a NULL run)
+uint64_t trace_run_next_report(const TraceRun* run);
+// Print or snapshot whatever is due at run->records; returns the record count of the next report
+uint64_t trace_run_report(TraceRun* run);
+
+// Replay a single record through a controller
+void simulate_trace_entry(CacheController* controller, const TraceEntry* entry);
+void simulate_trace_entry_enhanced(EnhancedCacheController* controller, const TraceEntry* entry);
+
 // Trace file functions
-int read_usimm_trace(const char* filename, TraceEntry** traces, int* num_traces);
-void process_usimm_trace(CacheController* controller, const char* filename);
-void process_usimm_trace_enhanced(EnhancedCacheController* controller, const char* filename);
+int read_usimm_trace(const char* filename, TraceEntry** traces, size_t* num_traces);
+// `run` may be NULL for a quiet replay
+void process_usimm_trace(CacheController* controller, const char* filename, TraceRun* run);
+void process_usimm_trace_enhanced(EnhancedCacheController* controller, const char* filename, TraceRun* run);
+void process_usimm_trace_stack_distance(StackDistanceProfile* profile, const char* filename);
+
+// Replay a built-in workload (see workload.h); 0 on success
+int process_workload(CacheController* controller, const WorkloadConfig* config, TraceRun* run);
+int process_workload_enhanced(EnhancedCacheController* controller, const WorkloadConfig* config, TraceRun* run);
 
 #endif // TRACE_PARSER_H
\ No newline at end of file
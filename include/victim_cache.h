@@ -0,0 +1,68 @@
+/**
+ * victim_cache.h
+ * Small fully-associative victim cache between L1 and L2
+ *
+ * Lines evicted from L1 (clean or dirty) are kept here; an L1 miss probes
+ * it before L2 and a hit swaps the line back into L1. A block is never in
+ * L1 and the victim cache at the same time. Dirty lines are written back
+ * to L2 only when they are pushed out of the victim cache.
+ */
+
+#ifndef VICTIM_CACHE_H
+#define VICTIM_CACHE_H
+
+#include "cache.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VICTIM_CACHE_MIN_ENTRIES 4
+#define VICTIM_CACHE_MAX_ENTRIES 32
+
+// A line handed out of the victim cache (data is unused when dataless)
+typedef struct {
+    uint32_t block_address;
+    bool dirty;
+    uint8_t data[1 << BLOCK_OFFSET_BITS];
+} VictimLine;
+
+typedef struct {
+    uint32_t blocks[VICTIM_CACHE_MAX_ENTRIES];
+    uint8_t rank[VICTIM_CACHE_MAX_ENTRIES];   // LRU recency rank, 0 = most recent
+    uint32_t valid_mask;
+    uint32_t dirty_mask;
+    uint8_t* data;                            // NULL when dataless
+    uint32_t capacity;
+
+    // Statistics
+    uint64_t probes;       // L1 misses that looked here
+    uint64_t hits;
+    uint64_t swaps;        // Hits that moved an L1 victim in at the same time
+    uint64_t fills;        // Lines received from L1
+    uint64_t evictions;
+    uint64_t write_backs;  // Dirty lines pushed out to L2
+} VictimCache;
+
+// `entries` must be within VICTIM_CACHE_MIN_ENTRIES..VICTIM_CACHE_MAX_ENTRIES
+VictimCache* create_victim_cache(uint32_t entries, bool dataless);
+void free_victim_cache(VictimCache* vc);
+
+// Entry holding the block, or -1; does not count as a probe
+int32_t victim_cache_find(const VictimCache* vc, uint32_t block_address);
+uint8_t* victim_cache_line_data(VictimCache* vc, uint32_t entry);
+void victim_cache_mark_dirty(VictimCache* vc, uint32_t entry);
+// Drop an entry (e.g. back-invalidation); returns whether it was dirty
+bool victim_cache_remove(VictimCache* vc, uint32_t entry);
+
+// Probe for an L1 miss; a hit removes the line and copies it to *line
+bool victim_cache_take(VictimCache* vc, uint32_t block_address, VictimLine* line);
+
+/**
+ * Insert a line evicted from L1 as the most recent entry. Returns true if
+ * the least recently used entry had to make room; it is copied to *evicted.
+ */
+bool victim_cache_put(VictimCache* vc, uint32_t block_address, const uint8_t* data, bool dirty,
+                      VictimLine* evicted);
+
+void print_victim_cache_stats(const VictimCache* vc, uint32_t latency, uint64_t l1_misses);
+
+#endif // VICTIM_CACHE_H
@@ -0,0 +1,86 @@
+/**
+ * workload.h
+ * Built-in synthetic workloads, generated as they are simulated
+ *
+ * A workload is a stream of loads and stores over a region of `footprint`
+ * bytes starting at address 0. The region is divided into slots of
+ * `stride` bytes; every pattern except the sequential stream touches one
+ * word at the start of a slot:
+ *   sequential     word after word, wrapping at the footprint
+ *   strided        slot after slot, wrapping at the footprint
+ *   random         uniformly random slots
+ *   zipf           slots drawn from a Zipf distribution (theta 0.99), so a
+ *                  few hot slots take most accesses; ranks are scattered
+ *                  over the footprint
+ *   pointer-chase  one random cycle through every slot, so each lap visits
+ *                  all of them in an order no prefetcher can follow
+ * Each access is a store with probability `write_percent`. The stream
+ * depends only on the configuration and seed, so runs are repeatable.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WORKLOAD_DEFAULT_FOOTPRINT (1u << 20)
+#define WORKLOAD_DEFAULT_STRIDE    64
+#define WORKLOAD_DEFAULT_ACCESSES  10000000ULL
+#define WORKLOAD_DEFAULT_WRITES    25
+#define WORKLOAD_ACCESS_SIZE       4     // Bytes per load or store
+#define WORKLOAD_ZIPF_THETA        0.99
+
+typedef enum {
+    WORKLOAD_SEQUENTIAL,
+    WORKLOAD_STRIDED,
+    WORKLOAD_RANDOM,
+    WORKLOAD_ZIPF,
+    WORKLOAD_POINTER_CHASE
+} WorkloadPattern;
+
+typedef struct {
+    WorkloadPattern pattern;
+    uint32_t footprint;      // Bytes; a power of two
+    uint32_t stride;         // Bytes per slot; a power of two, WORKLOAD_ACCESS_SIZE to footprint
+    uint64_t accesses;
+    uint32_t write_percent;  // 0-100
+    uint64_t seed;
+} WorkloadConfig;
+
+typedef struct {
+    WorkloadConfig config;
+    uint32_t slot_bits;      // log2(footprint / stride)
+    uint64_t generated;
+    uint64_t rng;
+    uint32_t position;       // Byte offset (sequential, strided) or slot (pointer-chase)
+
+    // Zipf sampling (Gray et al., "Quickly generating billion-record synthetic databases")
+    double zeta_n;
+    double eta;
+    double alpha;
+    double half_pow_theta;
+
+    uint32_t* next_slot;     // Pointer-chase cycle: slot -> following slot
+} WorkloadGenerator;
+
+void default_workload_config(WorkloadConfig* config);
+// Prints why and returns false if the footprint or stride are unusable
+bool check_workload_config(const WorkloadConfig* config);
+
+const char* workload_pattern_name(WorkloadPattern pattern);
+bool parse_workload_pattern(const char* name, WorkloadPattern* pattern);
+
+// NULL (with a message) if the configuration is invalid or memory runs out
+WorkloadGenerator* create_workload_generator(const WorkloadConfig* config);
+void free_workload_generator(WorkloadGenerator* generator);
+
+/**
+ * Produce the next access; returns false once config.accesses have been
+ * generated. `random` receives 64 random bits for the store's data.
+ */
+bool workload_next(WorkloadGenerator* generator, uint32_t* address, bool* is_write, uint64_t* random);
+
+void print_workload_config(const WorkloadConfig* config);
+
+#endif // WORKLOAD_H
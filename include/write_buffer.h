@@ -8,30 +8,61 @@
  
  #include "cache.h"  // Add this to get Cache definition and BLOCK_OFFSET_BITS
  
- #define WRITE_BUFFER_SIZE 16
+ #define WRITE_BUFFER_SIZE 16             // Default depth
+ #define WRITE_BUFFER_DRAIN_THRESHOLD 12  // Default occupancy kept after each store; set it to the
+                                          // depth to drain only when a store finds the buffer full
+ #define WRITE_BUFFER_MAX_SIZE 4096
  #define WB_BLOCK_SIZE 64  // Same as L1_BLOCK_SIZE
  
+ /**
+  * One buffered block. byte_mask records which bytes stores have written,
+  * so a drain merges only those and a load is forwarded only when its
+  * byte is present.
+  */
  typedef struct {
-     bool valid;
-     bool dirty;
-     uint32_t address;
+     uint32_t block_address;
+     int32_t next;          // Next entry in the same hash bucket, or -1
+     uint64_t byte_mask;
      uint8_t data[WB_BLOCK_SIZE];
-     uint64_t insertion_time;
  } WriteBufferEntry;
  
+ /**
+  * Entries form a FIFO ring (oldest at `head`) and are found by block
+  * address through a chained hash index, so lookups do not scan the buffer.
+  */
  typedef struct {
-     WriteBufferEntry entries[WRITE_BUFFER_SIZE];
+     WriteBufferEntry* entries;
+     uint32_t depth;
+     uint32_t head;
      uint32_t num_entries;
-     uint64_t counter;
+     uint32_t drain_threshold;
+     int32_t* buckets;
+     uint32_t bucket_bits;
      
      // Statistics
-     uint64_t write_backs;
+     uint64_t write_backs;        // Entries drained, wherever they went
+     uint64_t drains_to_l1;
+     uint64_t drains_to_l2;
+     uint64_t drains_to_memory;
+     uint64_t full_drains;        // Drains forced by a store finding the buffer full
      uint64_t coalesced_writes;
+     uint64_t forwarded_reads;
  } WriteBuffer;
  
- WriteBuffer* create_write_buffer();
+ WriteBuffer* create_write_buffer(uint32_t depth, uint32_t drain_threshold);
+ void free_write_buffer(WriteBuffer* wb);
+ 
+ // Forward a load from the buffer; true only if the addressed byte was stored
  bool check_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data);
- void insert_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data);
- void flush_write_buffer(WriteBuffer* wb, Cache* cache);
  
- #endif // WRITE_BUFFER_H
\ No newline at end of file
+ // Buffer or coalesce a store; false if the block is new and the buffer is full
+ bool insert_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data);
+ 
+ // Oldest entry (NULL when empty) and its removal once it has been drained
+ const WriteBufferEntry* write_buffer_oldest(const WriteBuffer* wb);
+ void write_buffer_pop(WriteBuffer* wb);
+ 
+ // Copy the stored bytes of `entry` into a block
+ void merge_write_buffer_entry(const WriteBufferEntry* entry, uint8_t* block);
+ 
+ #endif // WRITE_BUFFER_H
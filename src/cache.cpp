@@ -4,15 +4,32 @@
  */
 
  #include "cache.h"
- #include "replacement.h"  // Add this line
+ #include "replacement.h"
+ #include "cache_analysis.h"
+ #include "profile.h"
  #include <stdlib.h>
  #include <string.h>
  #include <stdio.h>
- 
- Cache* create_cache(uint32_t size, uint32_t block_size, uint32_t associativity, 
-    uint32_t index_bits, uint32_t tag_bits, ReplacementPolicy policy) {
-// Calculate the actual size needed per cache line
-size_t cacheline_size = sizeof(CacheLine) + block_size;
+ #if defined(__SSE2__)
+ #include <immintrin.h>
+ #endif
+
+ static void* alloc_aligned(size_t alignment, size_t size) {
+     // aligned_alloc requires size to be a multiple of the alignment
+     size = (size + alignment - 1) & ~(alignment - 1);
+     void* ptr = aligned_alloc(alignment, size);
+     if (ptr) memset(ptr, 0, size);
+     return ptr;
+ }
+
+ static void select_cache_kernels(Cache* cache);
+
+ Cache* create_cache(uint32_t size, uint32_t block_size, uint32_t associativity,
+    uint32_t index_bits, uint32_t tag_bits, ReplacementPolicy policy, bool dataless) {
+if (associativity == 0 || associativity > MAX_ASSOCIATIVITY) return NULL;
+if (policy == PLRU && (associativity & (associativity - 1)) != 0) return NULL;
+// The index field must address exactly the sets the geometry gives
+if (index_bits >= 32 || size != (block_size * associativity) << index_bits) return NULL;
 
 Cache* cache = (Cache*)calloc(1, sizeof(Cache));
 if (!cache) return NULL;
@@ -23,7 +40,9 @@ cache->block_size = block_size;
 cache->index_bits = index_bits;
 cache->tag_bits = tag_bits;
 cache->policy = policy;
-cache->access_counter = 0;
+cache->num_banks = 1;
+cache->way_stride = (associativity + TAG_ROW_ALIGN_WAYS - 1) & ~(TAG_ROW_ALIGN_WAYS - 1);
+cache->full_mask = associativity == 64 ? ~0ULL : ((1ULL << associativity) - 1);
 
 // Initialize statistics
 cache->accesses = 0;
@@ -31,178 +50,402 @@ cache->hits = 0;
 cache->misses = 0;
 cache->write_backs = 0;
 
-// Allocate sets
-cache->sets = (CacheLine**)calloc(cache->num_sets, sizeof(CacheLine*));
-if (!cache->sets) {
-free(cache);
+size_t lines = (size_t)cache->num_sets * associativity;
+
+// Allocate the tag store (all zero: every line starts invalid and clean)
+cache->tags = (uint32_t*)alloc_aligned(32, (size_t)cache->num_sets * cache->way_stride * sizeof(uint32_t));
+cache->valid_mask = (uint64_t*)calloc(cache->num_sets, sizeof(uint64_t));
+cache->dirty_mask = (uint64_t*)calloc(cache->num_sets, sizeof(uint64_t));
+cache->prefetched_mask = (uint64_t*)calloc(cache->num_sets, sizeof(uint64_t));
+if (!init_replacement_state(cache)) {
+free_cache(cache);
 return NULL;
 }
+// Tag-only caches keep metadata alone; data stays NULL and every copy is skipped
+cache->data = dataless ? NULL : (uint8_t*)calloc(lines, block_size);
 
-// Allocate cache lines for each set
-for (uint32_t i = 0; i < cache->num_sets; i++) {
-// Allocate all ways contiguously
-cache->sets[i] = (CacheLine*)calloc(associativity, cacheline_size);
-if (!cache->sets[i]) {
-// Clean up previously allocated memory
-for (uint32_t j = 0; j < i; j++) {
- free(cache->sets[j]);
-}
-free(cache->sets);
-free(cache);
+if (!cache->tags || !cache->valid_mask || !cache->dirty_mask || !cache->prefetched_mask ||
+    (!dataless && !cache->data)) {
+free_cache(cache);
 return NULL;
 }
 
-// Initialize each cache line
-for (uint32_t j = 0; j < associativity; j++) {
-CacheLine* line = (CacheLine*)((char*)cache->sets[i] + j * cacheline_size);
-line->valid = false;
-line->dirty = false;
-line->tag = 0;
-line->last_access_time = 0;
-memset(line->data, 0, block_size);
-}
-}
+cache_seed_random(cache, DEFAULT_RANDOM_SEED);
+select_cache_kernels(cache);
 
 return cache;
 }
 
+ void cache_seed_random(Cache* cache, uint64_t seed) {
+     // splitmix64 spreads nearby seeds apart and never yields the
+     // all-zero state xorshift cannot leave
+     uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+     z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+     z ^= z >> 31;
+     cache->rng_seed = seed;
+     cache->rng_state = z ? z : 1;
+ }
+
  void free_cache(Cache* cache) {
      if (cache) {
-         if (cache->sets) {
-             for (uint32_t i = 0; i < cache->num_sets; i++) {
-                 free(cache->sets[i]);
-             }
-             free(cache->sets);
-         }
+         free(cache->tags);
+         free(cache->valid_mask);
+         free(cache->dirty_mask);
+         free(cache->prefetched_mask);
+         free(cache->age_rank);
+         free(cache->repl_state);
+         free(cache->data);
+         free(cache->bank_accesses);
+         free(cache->set_stats);
+         free_miss_classifier(cache->classifier);
          free(cache);
      }
  }
+
+ /**
+  * Compare `tag` against every way of a tag row and return one bit per
+  * matching way. Rows are padded to TAG_ROW_ALIGN_WAYS and 32-byte aligned,
+  * so 8 ways cost one AVX2 compare (two SSE2) and 16 ways two (four SSE2).
+  * Padding and invalid ways are masked off by the caller.
+  */
+ static inline uint64_t match_tag_row(const uint32_t* row, uint32_t way_stride, uint32_t tag) {
+     uint64_t match = 0;
+ #if defined(__AVX2__)
+     __m256i key = _mm256_set1_epi32((int)tag);
+     for (uint32_t w = 0; w < way_stride; w += 8) {
+         __m256i t = _mm256_load_si256((const __m256i*)(row + w));
+         uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(t, key)));
+         match |= (uint64_t)bits << w;
+     }
+ #elif defined(__SSE2__)
+     __m128i key = _mm_set1_epi32((int)tag);
+     for (uint32_t w = 0; w < way_stride; w += 4) {
+         __m128i t = _mm_load_si128((const __m128i*)(row + w));
+         uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(t, key)));
+         match |= (uint64_t)bits << w;
+     }
+ #else
+     for (uint32_t w = 0; w < way_stride; w++) {
+         match |= (uint64_t)(row[w] == tag) << w;
+     }
+ #endif
+     return match;
+ }
+
+ int32_t cache_find_way(const Cache* cache, uint32_t set_index, uint32_t tag) {
+     const uint32_t* row = &cache->tags[(size_t)set_index * cache->way_stride];
+     uint64_t hit = match_tag_row(row, cache->way_stride, tag) & cache->valid_mask[set_index];
+     return hit ? (int32_t)__builtin_ctzll(hit) : -1;
+ }
+
+ bool cache_set_full(const Cache* cache, uint32_t set_index) {
+     return cache->valid_mask[set_index] == cache->full_mask;
+ }
+
+ bool cache_line_valid(const Cache* cache, uint32_t set_index, uint32_t way) {
+     return (cache->valid_mask[set_index] >> way) & 1;
+ }
+
+ bool cache_line_dirty(const Cache* cache, uint32_t set_index, uint32_t way) {
+     return (cache->dirty_mask[set_index] >> way) & 1;
+ }
+
+ uint32_t cache_line_tag(const Cache* cache, uint32_t set_index, uint32_t way) {
+     return cache->tags[(size_t)set_index * cache->way_stride + way];
+ }
+
+ uint8_t* cache_line_data(Cache* cache, uint32_t set_index, uint32_t way) {
+     if (!cache->data) return NULL;
+     return &cache->data[((size_t)set_index * cache->associativity + way) * cache->block_size];
+ }
+
+ bool cache_line_prefetched(const Cache* cache, uint32_t set_index, uint32_t way) {
+     return (cache->prefetched_mask[set_index] >> way) & 1;
+ }
  
-bool cache_read(Cache* cache, uint32_t address, uint8_t* data) {
-    if (!cache || !cache->sets) return false;
-    
-    cache->accesses++;  // Move this to the start of the function
-    
-    uint32_t tag = get_tag(address, cache->tag_bits, cache->index_bits);
-    uint32_t set_index = get_index(address, cache->index_bits);
-    uint32_t offset = get_offset(address);
-    
-    if (set_index >= cache->num_sets) return false;
-    
-    size_t cacheline_size = sizeof(CacheLine) + cache->block_size;
-    
-    for (uint32_t i = 0; i < cache->associativity; i++) {
-        CacheLine* line = (CacheLine*)((char*)cache->sets[set_index] + i * cacheline_size);
-        if (line->valid && line->tag == tag) {
-            // Cache hit
-            cache->hits++;
-            line->last_access_time = cache->access_counter++;
-            
-            if (data && offset < cache->block_size) {
-                memcpy(data, &line->data[offset], 1);
-            }
-            return true;
-        }
-    }
-    
-    // Cache miss
-    cache->misses++;
-    return false;
-}
+ void cache_mark_prefetched(Cache* cache, uint32_t set_index, uint32_t way) {
+     cache->prefetched_mask[set_index] |= 1ULL << way;
+ }
  
- bool cache_write(Cache* cache, uint32_t address, uint8_t* data) {
+ // The line's data has been written back elsewhere (e.g. a coherence flush)
+ void cache_clean_line(Cache* cache, uint32_t set_index, uint32_t way) {
+     cache->dirty_mask[set_index] &= ~(1ULL << way);
+ }
+ 
+ void cache_invalidate_line(Cache* cache, uint32_t set_index, uint32_t way) {
+     uint64_t bit = 1ULL << way;
+     if (cache->prefetched_mask[set_index] & bit) {
+         cache->prefetch_unused++;
+         cache->prefetched_mask[set_index] &= ~bit;
+     }
+     cache->valid_mask[set_index] &= ~bit;
+     cache->dirty_mask[set_index] &= ~bit;
+ }
+ 
+ // A demand hit consumes the line's prefetched bit
+ static inline void note_demand_hit(Cache* cache, uint32_t set_index, uint32_t way) {
+     uint64_t bit = 1ULL << way;
+     cache->last_hit_prefetched = (cache->prefetched_mask[set_index] & bit) != 0;
+     if (cache->last_hit_prefetched) {
+         cache->prefetched_mask[set_index] &= ~bit;
+         cache->prefetch_hits++;
+     }
+ }
+
+/**
+ * Read/write kernels. WAYS and INDEX_BITS are either compile-time constants
+ * (so the tag-row compare unrolls and the address split folds to shifts) or
+ * DYNAMIC_GEOMETRY, in which case the values are read from the cache.
+ */
+ static const uint32_t DYNAMIC_GEOMETRY = ~0u;
+
+ template <uint32_t WAYS, uint32_t INDEX_BITS>
+ static inline int32_t locate_line(const Cache* cache, uint32_t address, uint32_t* set_out) {
+     const uint32_t index_bits = INDEX_BITS != DYNAMIC_GEOMETRY ? INDEX_BITS : cache->index_bits;
+     const uint32_t way_stride = WAYS != DYNAMIC_GEOMETRY
+         ? (WAYS + TAG_ROW_ALIGN_WAYS - 1) & ~(TAG_ROW_ALIGN_WAYS - 1)
+         : cache->way_stride;
+
+     uint32_t tag = address >> (BLOCK_OFFSET_BITS + index_bits);
+     uint32_t set_index = (address >> BLOCK_OFFSET_BITS) & ((1u << index_bits) - 1);
+     *set_out = set_index;
+
+     const uint32_t* row = &cache->tags[(size_t)set_index * way_stride];
+     uint64_t hit = match_tag_row(row, way_stride, tag) & cache->valid_mask[set_index];
+     return hit ? (int32_t)__builtin_ctzll(hit) : -1;
+ }
+
+ template <uint32_t WAYS, uint32_t INDEX_BITS>
+ static bool read_kernel(Cache* cache, uint32_t address, uint8_t* data) {
+     const uint32_t ways = WAYS != DYNAMIC_GEOMETRY ? WAYS : cache->associativity;
+
      cache->accesses++;
-     
-     uint32_t tag = get_tag(address, cache->tag_bits, cache->index_bits);
-     uint32_t set_index = get_index(address, cache->index_bits);
-     uint32_t offset = get_offset(address);
-     
-     // Check if we have a hit
-     for (uint32_t i = 0; i < cache->associativity; i++) {
-         CacheLine* line = &cache->sets[set_index][i];
-         
-         if (line->valid && line->tag == tag) {
-             // Cache hit
-             cache->hits++;
-             line->last_access_time = cache->access_counter++;
-             line->dirty = true;
-             
-             // Write data
-             if (data) {
-                 memcpy(&line->data[offset], data, 1);
-             }
-             
-             return true;
+
+     uint32_t set_index;
+     int32_t way = locate_line<WAYS, INDEX_BITS>(cache, address, &set_index);
+     if (way >= 0) {
+         // Cache hit
+         cache->hits++;
+         replacement_on_hit(cache, set_index, (uint32_t)way);
+         note_demand_hit(cache, set_index, (uint32_t)way);
+
+         if (data && cache->data) {
+             memcpy(data, &cache->data[((size_t)set_index * ways + way) * cache->block_size + get_offset(address)], 1);
          }
+         return true;
      }
-     
+
      // Cache miss
      cache->misses++;
+     cache->last_hit_prefetched = false;
      return false;
  }
- 
- void cache_insert(Cache* cache, uint32_t address, uint8_t* data, bool is_dirty) {
+
+ template <uint32_t WAYS, uint32_t INDEX_BITS>
+ static bool write_kernel(Cache* cache, uint32_t address, uint8_t* data) {
+     const uint32_t ways = WAYS != DYNAMIC_GEOMETRY ? WAYS : cache->associativity;
+
+     cache->accesses++;
+
+     uint32_t set_index;
+     int32_t way = locate_line<WAYS, INDEX_BITS>(cache, address, &set_index);
+     if (way >= 0) {
+         // Cache hit
+         cache->hits++;
+         replacement_on_hit(cache, set_index, (uint32_t)way);
+         note_demand_hit(cache, set_index, (uint32_t)way);
+         cache->dirty_mask[set_index] |= 1ULL << way;
+
+         // Write data
+         if (data && cache->data) {
+             memcpy(&cache->data[((size_t)set_index * ways + way) * cache->block_size + get_offset(address)], data, 1);
+         }
+         return true;
+     }
+
+     // Cache miss
+     cache->misses++;
+     cache->last_hit_prefetched = false;
+     return false;
+ }
+
+ typedef struct {
+     uint32_t ways;
+     uint32_t index_bits;
+     bool (*read)(Cache*, uint32_t, uint8_t*);
+     bool (*write)(Cache*, uint32_t, uint8_t*);
+ } CacheKernels;
+
+ #define SPECIALIZE(ways, bits) { ways, bits, read_kernel<ways, bits>, write_kernel<ways, bits> }
+
+ // Geometries the simulator and the default sweep grid actually use
+ static const CacheKernels specialized_kernels[] = {
+     SPECIALIZE(4, 6),  SPECIALIZE(4, 7),  SPECIALIZE(4, 8),  SPECIALIZE(4, 9),
+     SPECIALIZE(8, 5),  SPECIALIZE(8, 6),  SPECIALIZE(8, 7),  SPECIALIZE(8, 8),
+     SPECIALIZE(8, 9),  SPECIALIZE(8, 10),
+     SPECIALIZE(16, 6), SPECIALIZE(16, 7), SPECIALIZE(16, 8), SPECIALIZE(16, 9),
+     SPECIALIZE(16, 10),
+ };
+
+ #undef SPECIALIZE
+
+ static void select_cache_kernels(Cache* cache) {
+     cache->read_kernel = read_kernel<DYNAMIC_GEOMETRY, DYNAMIC_GEOMETRY>;
+     cache->write_kernel = write_kernel<DYNAMIC_GEOMETRY, DYNAMIC_GEOMETRY>;
+
+     for (size_t i = 0; i < sizeof(specialized_kernels) / sizeof(specialized_kernels[0]); i++) {
+         const CacheKernels* k = &specialized_kernels[i];
+         if (k->ways == cache->associativity && k->index_bits == cache->index_bits) {
+             cache->read_kernel = k->read;
+             cache->write_kernel = k->write;
+             return;
+         }
+     }
+ }
+
+ bool cache_set_banks(Cache* cache, uint32_t banks) {
+     if (banks == 0 || (banks & (banks - 1)) != 0 || banks > MAX_CACHE_BANKS || banks > cache->num_sets) {
+         return false;
+     }
+     free(cache->bank_accesses);
+     cache->bank_accesses = NULL;
+     cache->num_banks = banks;
+     if (banks > 1) {
+         cache->bank_accesses = (uint64_t*)calloc(banks, sizeof(uint64_t));
+         if (!cache->bank_accesses) {
+             cache->num_banks = 1;
+             return false;
+         }
+     }
+     return true;
+ }
+
+ bool cache_enable_set_stats(Cache* cache) {
+     if (!cache->set_stats) {
+         cache->set_stats = (SetCounters*)calloc(cache->num_sets, sizeof(SetCounters));
+     }
+     return cache->set_stats != NULL;
+ }
+
+ bool cache_enable_miss_classes(Cache* cache) {
+     if (!cache->classifier) {
+         cache->classifier = create_miss_classifier(cache->num_sets * cache->associativity);
+     }
+     return cache->classifier != NULL;
+ }
+
+ // Bookkeeping of the optional analyses, kept out of the lookup kernels
+ static inline void note_access(Cache* cache, uint32_t address, bool hit) {
+     if (cache->set_stats) {
+         SetCounters* set = &cache->set_stats[get_index(address, cache->index_bits)];
+         set->accesses++;
+         set->misses += !hit;
+     }
+     if (cache->classifier) classify_access(cache->classifier, address, hit);
+ }
+
+ bool cache_read(Cache* cache, uint32_t address, uint8_t* data) {
+     PROFILE_SCOPE(PROFILE_CACHE_READ);
+     if (cache->bank_accesses) cache->bank_accesses[cache_bank_of(cache, address)]++;
+     bool hit = cache->read_kernel(cache, address, data);
+     if (cache->set_stats || cache->classifier) note_access(cache, address, hit);
+     return hit;
+ }
+
+ bool cache_write(Cache* cache, uint32_t address, uint8_t* data) {
+     PROFILE_SCOPE(PROFILE_CACHE_WRITE);
+     if (cache->bank_accesses) cache->bank_accesses[cache_bank_of(cache, address)]++;
+     bool hit = cache->write_kernel(cache, address, data);
+     if (cache->set_stats || cache->classifier) note_access(cache, address, hit);
+     return hit;
+ }
+
+ uint32_t cache_insert(Cache* cache, uint32_t address, uint8_t* data, bool is_dirty) {
+     PROFILE_SCOPE(PROFILE_CACHE_INSERT);
      uint32_t tag = get_tag(address, cache->tag_bits, cache->index_bits);
      uint32_t set_index = get_index(address, cache->index_bits);
-     
+
      // Find an empty way or select a victim
-     uint32_t way = cache->associativity;
-     for (uint32_t i = 0; i < cache->associativity; i++) {
-         if (!cache->sets[set_index][i].valid) {
-             way = i;
-             break;
-         }
-     }
-     
-     // If no invalid line found, use replacement policy
-     if (way == cache->associativity) {
+     uint32_t way;
+     uint64_t free_ways = ~cache->valid_mask[set_index] & cache->full_mask;
+     if (free_ways) {
+         way = (uint32_t)__builtin_ctzll(free_ways);
+     } else {
+         // If no invalid line found, use replacement policy
          way = get_victim_way(cache, set_index);
      }
-     
-     // Update cache line
-     cache->sets[set_index][way].valid = true;
-     cache->sets[set_index][way].dirty = is_dirty;
-     cache->sets[set_index][way].tag = tag;
-     cache->sets[set_index][way].last_access_time = cache->access_counter++;
-     
+
+     // Update cache line; a prefetched victim that was never used is wasted
+     uint64_t bit = 1ULL << way;
+     if (cache->prefetched_mask[set_index] & bit) {
+         cache->prefetch_unused++;
+         cache->prefetched_mask[set_index] &= ~bit;
+     }
+     cache->tags[(size_t)set_index * cache->way_stride + way] = tag;
+     cache->valid_mask[set_index] |= bit;
+     if (is_dirty) {
+         cache->dirty_mask[set_index] |= bit;
+     } else {
+         cache->dirty_mask[set_index] &= ~bit;
+     }
+     replacement_on_fill(cache, set_index, way);
+
      // Copy data
-     if (data) {
-         memcpy(cache->sets[set_index][way].data, data, cache->block_size);
+     if (data && cache->data) {
+         memcpy(cache_line_data(cache, set_index, way), data, cache->block_size);
      }
+     return way;
  }
- 
+
  uint32_t get_tag(uint32_t address, uint32_t tag_bits, uint32_t index_bits) {
     (void)tag_bits;  // Mark as unused to avoid warnings
     return address >> (BLOCK_OFFSET_BITS + index_bits);
 }
- 
+
  uint32_t get_index(uint32_t address, uint32_t index_bits) {
      uint32_t mask = (1 << index_bits) - 1;
      return (address >> BLOCK_OFFSET_BITS) & mask;
  }
- 
+
  uint32_t get_offset(uint32_t address) {
      return address & ((1 << BLOCK_OFFSET_BITS) - 1);
  }
- 
+
  uint32_t reconstruct_address(uint32_t tag, uint32_t index, uint32_t offset, uint32_t index_bits) {
      uint32_t address = tag;
      address = (address << index_bits) | index;
      address = (address << BLOCK_OFFSET_BITS) | offset;
      return address;
  }
- 
+
 void print_cache_stats(Cache* cache, const char* name) {
     printf("===== %s Statistics =====\n", name);
     printf("Total accesses: %llu\n", cache->accesses);
-    printf("Hits: %llu (%.2f%%)\n", cache->hits, 
+    printf("Hits: %llu (%.2f%%)\n", cache->hits,
           cache->accesses > 0 ? (double)cache->hits / cache->accesses * 100 : 0);
-    printf("Misses: %llu (%.2f%%)\n", cache->misses, 
+    printf("Misses: %llu (%.2f%%)\n", cache->misses,
           cache->accesses > 0 ? (double)cache->misses / cache->accesses * 100 : 0);
     printf("Hit rate: %.2f%%\n",
           cache->accesses > 0 ? (double)cache->hits / cache->accesses * 100 : 0);
     printf("Miss rate: %.2f%%\n",
           cache->accesses > 0 ? (double)cache->misses / cache->accesses * 100 : 0);
     printf("Write-backs: %llu\n", cache->write_backs);
+    if (cache->classifier) {
+        print_miss_classes(cache->classifier);
+    }
+    if (cache->set_stats) {
+        // The set with the most misses shows how uneven the index mapping is
+        uint32_t hottest = 0;
+        for (uint32_t s = 1; s < cache->num_sets; s++) {
+            if (cache->set_stats[s].misses > cache->set_stats[hottest].misses) hottest = s;
+        }
+        printf("Hottest set: %u with %llu misses (%.2fx the mean)\n", hottest,
+               (unsigned long long)cache->set_stats[hottest].misses,
+               cache->misses > 0 ? (double)cache->set_stats[hottest].misses * cache->num_sets / cache->misses : 0);
+    }
+    if (cache->policy == RANDOM || cache->policy == BRRIP || cache->policy == DRRIP) {
+        printf("Random seed: %llu\n", (unsigned long long)cache->rng_seed);
+    }
     printf("==========================\n");
-}
\ No newline at end of file
+}
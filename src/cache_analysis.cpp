@@ -0,0 +1,182 @@
+/**
+ * cache_analysis.cpp
+ * 3C miss classification and per-set heat maps
+ */
+
+#include "cache_analysis.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NO_SLOT UINT32_MAX
+#define ADDRESS_BLOCKS (1ULL << (ADDR_BITS - BLOCK_OFFSET_BITS))
+
+MissClassifier* create_miss_classifier(uint32_t lines) {
+    MissClassifier* classifier = (MissClassifier*)calloc(1, sizeof(MissClassifier));
+    if (!classifier) return NULL;
+
+    // At most half full, so probe sequences stay short
+    uint32_t table_bits = 1;
+    while ((1u << table_bits) < 2 * lines) table_bits++;
+    uint32_t table_size = 1u << table_bits;
+
+    classifier->capacity = lines;
+    classifier->head = NO_SLOT;
+    classifier->tail = NO_SLOT;
+    classifier->table_mask = table_size - 1;
+    classifier->table_shift = 32 - table_bits;
+    classifier->blocks = (uint32_t*)malloc(sizeof(uint32_t) * lines);
+    classifier->prev = (uint32_t*)malloc(sizeof(uint32_t) * lines);
+    classifier->next = (uint32_t*)malloc(sizeof(uint32_t) * lines);
+    classifier->table = (int32_t*)malloc(sizeof(int32_t) * table_size);
+    classifier->seen = (uint64_t*)calloc(ADDRESS_BLOCKS / 64, sizeof(uint64_t));
+    if (!classifier->blocks || !classifier->prev || !classifier->next || !classifier->table ||
+        !classifier->seen) {
+        free_miss_classifier(classifier);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < table_size; i++) {
+        classifier->table[i] = -1;
+    }
+    return classifier;
+}
+
+void free_miss_classifier(MissClassifier* classifier) {
+    if (classifier) {
+        free(classifier->blocks);
+        free(classifier->prev);
+        free(classifier->next);
+        free(classifier->table);
+        free(classifier->seen);
+        free(classifier);
+    }
+}
+
+static inline uint32_t home_position(const MissClassifier* classifier, uint32_t block) {
+    // Fibonacci hashing: the top bits of the product are the best mixed
+    return (block * 0x9E3779B1u) >> classifier->table_shift;
+}
+
+// Table position holding `block`, or the empty position where it would go
+static uint32_t table_position(const MissClassifier* classifier, uint32_t block, bool* found) {
+    uint32_t pos = home_position(classifier, block);
+    while (classifier->table[pos] >= 0) {
+        if (classifier->blocks[classifier->table[pos]] == block) {
+            *found = true;
+            return pos;
+        }
+        pos = (pos + 1) & classifier->table_mask;
+    }
+    *found = false;
+    return pos;
+}
+
+// Delete by shifting later entries of the probe run back (no tombstones)
+static void table_remove(MissClassifier* classifier, uint32_t hole) {
+    uint32_t mask = classifier->table_mask;
+    uint32_t pos = (hole + 1) & mask;
+    while (classifier->table[pos] >= 0) {
+        uint32_t home = home_position(classifier, classifier->blocks[classifier->table[pos]]);
+        if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+            classifier->table[hole] = classifier->table[pos];
+            hole = pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    classifier->table[hole] = -1;
+}
+
+static void unlink_slot(MissClassifier* classifier, uint32_t slot) {
+    uint32_t prev = classifier->prev[slot];
+    uint32_t next = classifier->next[slot];
+    if (prev != NO_SLOT) classifier->next[prev] = next;
+    else classifier->head = next;
+    if (next != NO_SLOT) classifier->prev[next] = prev;
+    else classifier->tail = prev;
+}
+
+static void push_front(MissClassifier* classifier, uint32_t slot) {
+    classifier->prev[slot] = NO_SLOT;
+    classifier->next[slot] = classifier->head;
+    if (classifier->head != NO_SLOT) classifier->prev[classifier->head] = slot;
+    classifier->head = slot;
+    if (classifier->tail == NO_SLOT) classifier->tail = slot;
+}
+
+void classify_access(MissClassifier* classifier, uint32_t address, bool hit) {
+    uint32_t block = address >> BLOCK_OFFSET_BITS;
+    uint64_t bit = 1ULL << (block & 63);
+    bool first_touch = !(classifier->seen[block >> 6] & bit);
+    classifier->seen[block >> 6] |= bit;
+
+    bool shadow_hit;
+    uint32_t pos = table_position(classifier, block, &shadow_hit);
+    if (shadow_hit) {
+        uint32_t slot = (uint32_t)classifier->table[pos];
+        if (slot != classifier->head) {
+            unlink_slot(classifier, slot);
+            push_front(classifier, slot);
+        }
+    } else {
+        uint32_t slot;
+        if (classifier->count < classifier->capacity) {
+            slot = classifier->count++;
+        } else {
+            // Replace the least recently used block
+            slot = classifier->tail;
+            bool found;
+            table_remove(classifier, table_position(classifier, classifier->blocks[slot], &found));
+            unlink_slot(classifier, slot);
+            // The removal may have shifted the free position for `block`
+            pos = table_position(classifier, block, &found);
+        }
+        classifier->blocks[slot] = block;
+        classifier->table[pos] = (int32_t)slot;
+        push_front(classifier, slot);
+    }
+
+    if (hit) return;
+    if (first_touch) {
+        classifier->compulsory++;
+    } else if (!shadow_hit) {
+        classifier->capacity_misses++;
+    } else {
+        classifier->conflict++;
+    }
+}
+
+void print_miss_classes(const MissClassifier* classifier) {
+    uint64_t misses = classifier->compulsory + classifier->capacity_misses + classifier->conflict;
+    printf("Miss classes: compulsory %llu (%.2f%%), capacity %llu (%.2f%%), conflict %llu (%.2f%%)\n",
+           (unsigned long long)classifier->compulsory,
+           misses > 0 ? (double)classifier->compulsory / misses * 100 : 0,
+           (unsigned long long)classifier->capacity_misses,
+           misses > 0 ? (double)classifier->capacity_misses / misses * 100 : 0,
+           (unsigned long long)classifier->conflict,
+           misses > 0 ? (double)classifier->conflict / misses * 100 : 0);
+}
+
+bool write_set_heat_map(const char* filename, const Cache* const* caches, const char* const* names,
+                        uint32_t count) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open heat map file: %s\n", filename);
+        return false;
+    }
+
+    fprintf(file, "cache,set,accesses,misses,evictions,miss_rate\n");
+    for (uint32_t c = 0; c < count; c++) {
+        const Cache* cache = caches[c];
+        if (!cache->set_stats) continue;
+        for (uint32_t s = 0; s < cache->num_sets; s++) {
+            const SetCounters* set = &cache->set_stats[s];
+            fprintf(file, "%s,%u,%llu,%llu,%llu,%.4f\n", names[c], s,
+                    (unsigned long long)set->accesses, (unsigned long long)set->misses,
+                    (unsigned long long)set->evictions,
+                    set->accesses > 0 ? (double)set->misses / set->accesses : 0);
+        }
+    }
+
+    bool ok = fclose(file) == 0;
+    if (!ok) fprintf(stderr, "Failed to write heat map file: %s\n", filename);
+    return ok;
+}
@@ -0,0 +1,301 @@
+/**
+ * config.cpp
+ * Runtime cache geometry and policy configuration
+ */
+
+#include "config.h"
+#include "replacement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+bool parse_size_value(const char* text, uint32_t* value) {
+    char* end;
+    unsigned long long v = strtoull(text, &end, 10);
+    if (end == text) return false;
+    if (*end == 'K' || *end == 'k') { v <<= 10; end++; }
+    else if (*end == 'M' || *end == 'm') { v <<= 20; end++; }
+    if ((*end == 'B' || *end == 'b') && end[1] == '\0') end++;
+    if (*end != '\0' || v == 0 || v > UINT32_MAX) return false;
+    *value = (uint32_t)v;
+    return true;
+}
+
+static bool parse_bool_value(const char* text, bool* value) {
+    if (strcmp(text, "true") == 0 || strcmp(text, "1") == 0 || strcmp(text, "on") == 0) *value = true;
+    else if (strcmp(text, "false") == 0 || strcmp(text, "0") == 0 || strcmp(text, "off") == 0) *value = false;
+    else return false;
+    return true;
+}
+
+bool configure_cache_level(CacheConfig* level, const char* name, uint32_t size,
+                           uint32_t associativity, ReplacementPolicy policy) {
+    uint32_t block_size = 1u << BLOCK_OFFSET_BITS;
+    if (associativity == 0 || associativity > MAX_ASSOCIATIVITY) {
+        fprintf(stderr, "%s: associativity must be between 1 and %d\n", name, MAX_ASSOCIATIVITY);
+        return false;
+    }
+    if (policy == PLRU && (associativity & (associativity - 1)) != 0) {
+        fprintf(stderr, "%s: tree PLRU needs a power-of-two associativity\n", name);
+        return false;
+    }
+    uint64_t set_bytes = (uint64_t)block_size * associativity;
+    uint64_t sets = size / set_bytes;
+    if (sets == 0 || sets * set_bytes != size || (sets & (sets - 1)) != 0) {
+        fprintf(stderr, "%s: %u bytes at %u-way with %u-byte blocks does not give a power-of-two set count\n",
+                name, size, associativity, block_size);
+        return false;
+    }
+    if (__builtin_ctzll(sets) + BLOCK_OFFSET_BITS > ADDR_BITS) {
+        fprintf(stderr, "%s: too many sets for %d-bit addresses\n", name, ADDR_BITS);
+        return false;
+    }
+
+    level->size = size;
+    level->associativity = associativity;
+    level->index_bits = (uint32_t)__builtin_ctzll(sets);
+    level->policy = policy;
+    return true;
+}
+
+bool apply_config_option(ControllerConfig* config, const char* key, const char* value) {
+    uint32_t number;
+    ReplacementPolicy policy;
+    PrefetcherKind prefetcher;
+    InclusionPolicy inclusion;
+
+    if (strcmp(key, "l1-size") == 0 || strcmp(key, "l2-size") == 0) {
+        if (!parse_size_value(value, &number)) goto bad_value;
+        (key[1] == '1' ? config->l1 : config->l2).size = number;
+    } else if (strcmp(key, "l1-assoc") == 0 || strcmp(key, "l2-assoc") == 0) {
+        if (!parse_size_value(value, &number)) goto bad_value;
+        (key[1] == '1' ? config->l1 : config->l2).associativity = number;
+    } else if (strcmp(key, "l1-policy") == 0 || strcmp(key, "l2-policy") == 0) {
+        if (!parse_replacement_policy(value, &policy)) goto bad_value;
+        (key[1] == '1' ? config->l1 : config->l2).policy = policy;
+    } else if (strcmp(key, "policy") == 0) {
+        if (!parse_replacement_policy(value, &policy)) goto bad_value;
+        config->l1.policy = policy;
+        config->l2.policy = policy;
+    } else if (strcmp(key, "wb-depth") == 0) {
+        if (!parse_size_value(value, &number)) goto bad_value;
+        config->write_buffer_depth = number;
+    } else if (strcmp(key, "wb-drain") == 0) {
+        // 0 is allowed here: every store drains straight away
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > WRITE_BUFFER_MAX_SIZE) goto bad_value;
+        config->write_buffer_drain = (uint32_t)v;
+    } else if (strcmp(key, "l1-latency") == 0 || strcmp(key, "l2-latency") == 0 ||
+               strcmp(key, "wb-latency") == 0 || strcmp(key, "mem-latency") == 0 ||
+               strcmp(key, "victim-latency") == 0) {
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > 1000000) goto bad_value;
+        uint32_t* field = key[0] == 'w' ? &config->latency.write_buffer
+                        : key[0] == 'm' ? &config->latency.memory
+                        : key[0] == 'v' ? &config->latency.victim
+                        : key[1] == '1' ? &config->latency.l1 : &config->latency.l2;
+        *field = (uint32_t)v;
+    } else if (strcmp(key, "l1-mshrs") == 0 || strcmp(key, "l2-mshrs") == 0) {
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > MAX_MSHR_ENTRIES) goto bad_value;
+        if (key[1] == '1') config->l1_mshrs = (uint32_t)v;
+        else config->l2_mshrs = (uint32_t)v;
+    } else if (strcmp(key, "mshrs") == 0) {
+        // One count for both levels; "0" selects the blocking model
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > MAX_MSHR_ENTRIES) goto bad_value;
+        config->l1_mshrs = (uint32_t)v;
+        config->l2_mshrs = (uint32_t)v;
+    } else if (strcmp(key, "l2-banks") == 0) {
+        if (!parse_size_value(value, &number) || (number & (number - 1)) != 0 ||
+            number > MAX_CACHE_BANKS) goto bad_value;
+        config->l2.banks = number;
+    } else if (strcmp(key, "l2-bank-busy") == 0) {
+        // 0 keeps the L2 fully pipelined: banks are counted but never conflict
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > 1000000) goto bad_value;
+        config->l2_bank_busy = (uint32_t)v;
+    } else if (strcmp(key, "inclusion") == 0) {
+        if (!parse_inclusion_policy(value, &inclusion)) goto bad_value;
+        config->inclusion = inclusion;
+    } else if (strcmp(key, "victim-entries") == 0) {
+        // 0 turns the victim cache off
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > VICTIM_CACHE_MAX_ENTRIES ||
+            (v != 0 && v < VICTIM_CACHE_MIN_ENTRIES)) goto bad_value;
+        config->victim_entries = (uint32_t)v;
+    } else if (strcmp(key, "l1-prefetch") == 0 || strcmp(key, "l2-prefetch") == 0) {
+        if (!parse_prefetcher(value, &prefetcher)) goto bad_value;
+        if (key[1] == '1') config->l1_prefetch = prefetcher;
+        else config->l2_prefetch = prefetcher;
+    } else if (strcmp(key, "prefetch-degree") == 0) {
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v == 0 || v > PREFETCH_MAX_DEGREE) goto bad_value;
+        config->prefetch_degree = (uint32_t)v;
+    } else if (strcmp(key, "seed") == 0) {
+        char* end;
+        config->seed = strtoull(value, &end, 0);
+        if (end == value || *end != '\0') goto bad_value;
+    } else if (strcmp(key, "classify-misses") == 0) {
+        bool on;
+        if (!parse_bool_value(value, &on)) goto bad_value;
+        config->l1.classify_misses = on;
+        config->l2.classify_misses = on;
+    } else if (strcmp(key, "heat-map") == 0) {
+        // Per-set counters for both levels, written as CSV at the end
+        if (value[0] == '\0' || strlen(value) >= sizeof(config->heat_map)) goto bad_value;
+        strcpy(config->heat_map, value);
+        config->l1.set_stats = true;
+        config->l2.set_stats = true;
+    } else if (strcmp(key, "stats-file") == 0) {
+        if (value[0] == '\0' || strlen(value) >= sizeof(config->stats_file)) goto bad_value;
+        strcpy(config->stats_file, value);
+    } else if (strcmp(key, "stats-format") == 0) {
+        if (!parse_stats_format(value, &config->stats_format)) goto bad_value;
+    } else if (strcmp(key, "stats-interval") == 0 || strcmp(key, "progress") == 0) {
+        // Records between reports; 0 turns them off
+        char* end;
+        unsigned long long v = strtoull(value, &end, 10);
+        if (end == value || *end != '\0') goto bad_value;
+        if (key[0] == 's') config->stats_interval = v;
+        else config->progress_interval = v;
+    } else if (strcmp(key, "workload") == 0) {
+        if (!parse_workload_pattern(value, &config->workload.pattern)) goto bad_value;
+    } else if (strcmp(key, "workload-footprint") == 0 || strcmp(key, "workload-stride") == 0) {
+        // Checked against each other in finalize_controller_config
+        if (!parse_size_value(value, &number)) goto bad_value;
+        if (key[9] == 'f') config->workload.footprint = number;
+        else config->workload.stride = number;
+    } else if (strcmp(key, "workload-accesses") == 0 || strcmp(key, "workload-seed") == 0) {
+        char* end;
+        unsigned long long v = strtoull(value, &end, 0);
+        if (end == value || *end != '\0') goto bad_value;
+        if (key[9] == 'a') config->workload.accesses = v;
+        else config->workload.seed = v;
+    } else if (strcmp(key, "workload-writes") == 0) {
+        // Percentage of accesses that are stores
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (end == value || *end != '\0' || v > 100) goto bad_value;
+        config->workload.write_percent = (uint32_t)v;
+    } else if (strcmp(key, "dataless") == 0) {
+        if (!parse_bool_value(value, &config->dataless)) goto bad_value;
+    } else {
+        fprintf(stderr, "Unknown configuration key: %s\n", key);
+        return false;
+    }
+    return true;
+
+bad_value:
+    fprintf(stderr, "Invalid value for %s: %s\n", key, value);
+    return false;
+}
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+bool load_config_file(ControllerConfig* config, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open config file: %s\n", filename);
+        return false;
+    }
+
+    char line[256];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char* text = trim(line);
+        if (*text == '\0') continue;
+
+        char* eq = strchr(text, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: expected key = value\n", filename, line_number);
+            ok = false;
+            break;
+        }
+        *eq = '\0';
+        // Accept l1_size as well as l1-size
+        char* key = trim(text);
+        for (char* c = key; *c; c++) {
+            if (*c == '_') *c = '-';
+        }
+        if (!apply_config_option(config, key, trim(eq + 1))) {
+            fprintf(stderr, "%s:%d: invalid setting\n", filename, line_number);
+            ok = false;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+bool finalize_controller_config(ControllerConfig* config) {
+    if (config->write_buffer_depth == 0 || config->write_buffer_depth > WRITE_BUFFER_MAX_SIZE) {
+        fprintf(stderr, "Write buffer depth must be at most %d\n", WRITE_BUFFER_MAX_SIZE);
+        return false;
+    }
+    if (config->write_buffer_drain > config->write_buffer_depth) {
+        fprintf(stderr, "Write buffer drain threshold (%u) exceeds its depth (%u)\n",
+                config->write_buffer_drain, config->write_buffer_depth);
+        return false;
+    }
+    if ((config->l1_mshrs == 0) != (config->l2_mshrs == 0)) {
+        fprintf(stderr, "MSHRs must be enabled at both levels or at neither (--mshrs 0)\n");
+        return false;
+    }
+    if (!configure_cache_level(&config->l1, "L1", config->l1.size, config->l1.associativity,
+                               config->l1.policy) ||
+        !configure_cache_level(&config->l2, "L2", config->l2.size, config->l2.associativity,
+                               config->l2.policy)) {
+        return false;
+    }
+    if (config->l2.banks > 1u << config->l2.index_bits) {
+        fprintf(stderr, "L2: %u banks exceed its %u sets\n", config->l2.banks, 1u << config->l2.index_bits);
+        return false;
+    }
+    return check_workload_config(&config->workload);
+}
+
+static void print_level(const char* name, const CacheConfig* level) {
+    printf("%s: %uKB, %u-way, %u sets, %s", name, level->size >> 10, level->associativity,
+           1u << level->index_bits, replacement_policy_name(level->policy));
+    if (level->policy == DRRIP && (1u << level->index_bits) < DRRIP_MIN_SETS) {
+        printf(" (too few sets for set dueling: runs as srrip)");
+    }
+    printf("\n");
+}
+
+void print_controller_config(const ControllerConfig* config) {
+    print_level("L1", &config->l1);
+    print_level("L2", &config->l2);
+    if (config->l2.banks > 1 || config->l2_bank_busy > 0) {
+        printf("L2 banks: %u, %u busy cycles per lookup\n", config->l2.banks, config->l2_bank_busy);
+    }
+    if (config->inclusion != INCLUSION_NINE) {
+        printf("Inclusion: %s\n", inclusion_policy_name(config->inclusion));
+    }
+    if (config->victim_entries > 0) {
+        printf("Victim cache: %u entries\n", config->victim_entries);
+    }
+    if (config->l1_prefetch != PREFETCH_NONE || config->l2_prefetch != PREFETCH_NONE) {
+        printf("Prefetch: L1 %s, L2 %s, degree %u\n", prefetcher_name(config->l1_prefetch),
+               prefetcher_name(config->l2_prefetch), config->prefetch_degree);
+    }
+}
@@ -6,30 +6,137 @@
  #include "controller.h"
  #include "replacement.h"
  #include "write_buffer.h"
+ #include "profile.h"
  #include <stdlib.h>
  #include <string.h>
+ #include <strings.h>
  #include <stdio.h>
  
- CacheController* create_cache_controller() {
+ void default_controller_config(ControllerConfig* config) {
+     config->l1.size = L1_SIZE;
+     config->l1.associativity = L1_ASSOCIATIVITY;
+     config->l1.index_bits = L1_INDEX_BITS;
+     config->l1.policy = LRU;
+     config->l1.banks = 1;
+     config->l1.classify_misses = false;
+     config->l1.set_stats = false;
+     
+     config->l2.size = L2_SIZE;
+     config->l2.associativity = L2_ASSOCIATIVITY;
+     config->l2.index_bits = L2_INDEX_BITS;
+     config->l2.policy = LRU;
+     config->l2.banks = 1;
+     config->l2.classify_misses = false;
+     config->l2.set_stats = false;
+     
+     config->dataless = false;
+     config->seed = DEFAULT_RANDOM_SEED;
+     config->write_buffer_depth = WRITE_BUFFER_SIZE;
+     config->write_buffer_drain = WRITE_BUFFER_DRAIN_THRESHOLD;
+     default_latency_config(&config->latency);
+     config->l1_mshrs = L1_MSHR_ENTRIES;
+     config->l2_mshrs = L2_MSHR_ENTRIES;
+     config->l2_bank_busy = 0;
+     config->l1_prefetch = PREFETCH_NONE;
+     config->l2_prefetch = PREFETCH_NONE;
+     config->prefetch_degree = PREFETCH_DEFAULT_DEGREE;
+     config->victim_entries = 0;
+     config->inclusion = INCLUSION_NINE;
+     config->heat_map[0] = '\0';
+     config->stats_file[0] = '\0';
+     config->stats_format = STATS_JSON;
+     config->stats_interval = 0;
+     config->progress_interval = 0;
+     default_workload_config(&config->workload);
+ }
+ 
+ Cache* create_cache_level(const CacheConfig* level, bool dataless, uint64_t seed) {
+     Cache* cache = create_cache(level->size, 1 << BLOCK_OFFSET_BITS, level->associativity,
+                                 level->index_bits, ADDR_BITS - level->index_bits - BLOCK_OFFSET_BITS,
+                                 level->policy, dataless);
+     if (!cache) return NULL;
+     if (!cache_set_banks(cache, level->banks) ||
+         (level->classify_misses && !cache_enable_miss_classes(cache)) ||
+         (level->set_stats && !cache_enable_set_stats(cache))) {
+         free_cache(cache);
+         return NULL;
+     }
+     cache_seed_random(cache, seed);
+     return cache;
+ }
+ 
+ // Build the configured prefetchers; on failure nothing is left allocated
+ static bool create_prefetchers(const ControllerConfig* config, Prefetcher** l1, Prefetcher** l2) {
+     *l1 = create_prefetcher(config->l1_prefetch, config->prefetch_degree);
+     *l2 = create_prefetcher(config->l2_prefetch, config->prefetch_degree);
+     if ((config->l1_prefetch != PREFETCH_NONE && !*l1) ||
+         (config->l2_prefetch != PREFETCH_NONE && !*l2)) {
+         free_prefetcher(*l1);
+         free_prefetcher(*l2);
+         return false;
+     }
+     return true;
+ }
+ 
+ CacheController* create_cache_controller(const ControllerConfig* config) {
+     ControllerConfig defaults;
+     if (!config) {
+         default_controller_config(&defaults);
+         config = &defaults;
+     }
+     
      CacheController* controller = (CacheController*)malloc(sizeof(CacheController));
      if (!controller) return NULL;
      
-     controller->L1 = create_cache(L1_SIZE, L1_BLOCK_SIZE, L1_ASSOCIATIVITY, 
-                                  L1_INDEX_BITS, L1_TAG_BITS, LRU);
+     controller->L1 = create_cache_level(&config->l1, config->dataless, config->seed);
      if (!controller->L1) {
          free(controller);
          return NULL;
      }
-                                  
-     controller->L2 = create_cache(L2_SIZE, L2_BLOCK_SIZE, L2_ASSOCIATIVITY, 
-                                  L2_INDEX_BITS, L2_TAG_BITS, LRU);
+     
+     controller->L2 = create_cache_level(&config->l2, config->dataless, config->seed + 1);
      if (!controller->L2) {
          free_cache(controller->L1);
          free(controller);
          return NULL;
      }
      
+     if (!init_miss_pipeline(&controller->pipeline, config->l1_mshrs, config->l2_mshrs,
+                             config->l2.banks, config->l2_bank_busy)) {
+         free_cache(controller->L1);
+         free_cache(controller->L2);
+         free(controller);
+         return NULL;
+     }
+     
+     if (!create_prefetchers(config, &controller->l1_prefetcher, &controller->l2_prefetcher)) {
+         free_cache(controller->L1);
+         free_cache(controller->L2);
+         free_miss_pipeline(&controller->pipeline);
+         free(controller);
+         return NULL;
+     }
+     
+     controller->victim_cache = NULL;
+     if (config->victim_entries > 0) {
+         controller->victim_cache = create_victim_cache(config->victim_entries, config->dataless);
+         if (!controller->victim_cache) {
+             free_cache(controller->L1);
+             free_cache(controller->L2);
+             free_miss_pipeline(&controller->pipeline);
+             free_prefetcher(controller->l1_prefetcher);
+             free_prefetcher(controller->l2_prefetcher);
+             free(controller);
+             return NULL;
+         }
+     }
+     
+     controller->dataless = config->dataless;
+     controller->inclusion = config->inclusion;
+     memset(&controller->inclusion_stats, 0, sizeof(controller->inclusion_stats));
      controller->memory_accesses = 0;
+     controller->last_service = SERVICE_L1;
+     init_timing_stats(&controller->timing, &config->latency);
      return controller;
  }
  
@@ -37,30 +144,39 @@
      if (controller) {
          free_cache(controller->L1);
          free_cache(controller->L2);
+         free_miss_pipeline(&controller->pipeline);
+         free_prefetcher(controller->l1_prefetcher);
+         free_prefetcher(controller->l2_prefetcher);
+         free_victim_cache(controller->victim_cache);
          free(controller);
      }
  }
  
- EnhancedCacheController* create_enhanced_controller() {
+ EnhancedCacheController* create_enhanced_controller(const ControllerConfig* config) {
+     ControllerConfig defaults;
+     if (!config) {
+         default_controller_config(&defaults);
+         config = &defaults;
+     }
+     
      EnhancedCacheController* controller = (EnhancedCacheController*)malloc(sizeof(EnhancedCacheController));
      if (!controller) return NULL;
      
-     controller->L1 = create_cache(L1_SIZE, L1_BLOCK_SIZE, L1_ASSOCIATIVITY, 
-                                  L1_INDEX_BITS, L1_TAG_BITS, LRU);
+     controller->L1 = create_cache_level(&config->l1, config->dataless, config->seed);
      if (!controller->L1) {
          free(controller);
          return NULL;
      }
-                                  
-     controller->L2 = create_cache(L2_SIZE, L2_BLOCK_SIZE, L2_ASSOCIATIVITY, 
-                                  L2_INDEX_BITS, L2_TAG_BITS, LRU);
+     
+     controller->L2 = create_cache_level(&config->l2, config->dataless, config->seed + 1);
      if (!controller->L2) {
          free_cache(controller->L1);
          free(controller);
          return NULL;
      }
      
-     controller->write_buffer = create_write_buffer();
+     controller->write_buffer = create_write_buffer(config->write_buffer_depth,
+                                                    config->write_buffer_drain);
      if (!controller->write_buffer) {
          free_cache(controller->L1);
          free_cache(controller->L2);
@@ -68,7 +184,45 @@
          return NULL;
      }
      
+     if (!init_miss_pipeline(&controller->pipeline, config->l1_mshrs, config->l2_mshrs,
+                             config->l2.banks, config->l2_bank_busy)) {
+         free_cache(controller->L1);
+         free_cache(controller->L2);
+         free_write_buffer(controller->write_buffer);
+         free(controller);
+         return NULL;
+     }
+     
+     if (!create_prefetchers(config, &controller->l1_prefetcher, &controller->l2_prefetcher)) {
+         free_cache(controller->L1);
+         free_cache(controller->L2);
+         free_write_buffer(controller->write_buffer);
+         free_miss_pipeline(&controller->pipeline);
+         free(controller);
+         return NULL;
+     }
+     
+     controller->victim_cache = NULL;
+     if (config->victim_entries > 0) {
+         controller->victim_cache = create_victim_cache(config->victim_entries, config->dataless);
+         if (!controller->victim_cache) {
+             free_cache(controller->L1);
+             free_cache(controller->L2);
+             free_write_buffer(controller->write_buffer);
+             free_miss_pipeline(&controller->pipeline);
+             free_prefetcher(controller->l1_prefetcher);
+             free_prefetcher(controller->l2_prefetcher);
+             free(controller);
+             return NULL;
+         }
+     }
+     
+     controller->dataless = config->dataless;
+     controller->inclusion = config->inclusion;
+     memset(&controller->inclusion_stats, 0, sizeof(controller->inclusion_stats));
      controller->memory_accesses = 0;
+     controller->last_service = SERVICE_L1;
+     init_timing_stats(&controller->timing, &config->latency);
      return controller;
  }
  
@@ -76,102 +230,264 @@
      if (controller) {
          free_cache(controller->L1);
          free_cache(controller->L2);
-         free(controller->write_buffer);
+         free_write_buffer(controller->write_buffer);
+         free_miss_pipeline(&controller->pipeline);
+         free_prefetcher(controller->l1_prefetcher);
+         free_prefetcher(controller->l2_prefetcher);
+         free_victim_cache(controller->victim_cache);
          free(controller);
      }
  }
  
- void handle_eviction(CacheController* controller, Cache* cache, uint32_t set_index, uint32_t way) {
-     CacheLine* line = &cache->sets[set_index][way];
+ const char* inclusion_policy_name(InclusionPolicy inclusion) {
+     switch (inclusion) {
+         case INCLUSION_NINE: return "nine";
+         case INCLUSION_INCLUSIVE: return "inclusive";
+         case INCLUSION_EXCLUSIVE: return "exclusive";
+     }
+     return "unknown";
+ }
+ 
+ bool parse_inclusion_policy(const char* name, InclusionPolicy* inclusion) {
+     static const InclusionPolicy all[] = { INCLUSION_NINE, INCLUSION_INCLUSIVE, INCLUSION_EXCLUSIVE };
+     for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+         if (strcasecmp(name, inclusion_policy_name(all[i])) == 0) {
+             *inclusion = all[i];
+             return true;
+         }
+     }
+     return false;
+ }
+ 
+ static int32_t find_block(const Cache* cache, uint32_t block_address) {
+     return cache_find_way(cache, get_index(block_address, cache->index_bits),
+                           get_tag(block_address, cache->tag_bits, cache->index_bits));
+ }
+ 
+ /**
+  * Inclusion helpers. The L1 side is L1 plus its victim cache. Inclusive:
+  * an L2 victim takes its L1 copy with it, and a dirty copy's newer data
+  * goes to memory with the victim. Exclusive: L2 hits move up to L1 and
+  * every L1 victim, clean or dirty, moves down to L2.
+  */
+ template <typename Controller>
+ static bool back_invalidate(Controller* controller, uint32_t block_address) {
+     Cache* l1 = controller->L1;
+     uint32_t set_index = get_index(block_address, l1->index_bits);
+     int32_t way = find_block(l1, block_address);
+     bool dirty;
+     if (way >= 0) {
+         dirty = cache_line_dirty(l1, set_index, (uint32_t)way);
+         cache_invalidate_line(l1, set_index, (uint32_t)way);
+     } else {
+         VictimCache* vc = controller->victim_cache;
+         int32_t entry = vc ? victim_cache_find(vc, block_address) : -1;
+         if (entry < 0) return false;
+         dirty = victim_cache_remove(vc, (uint32_t)entry);
+     }
      
-     if (line->valid && line->dirty) {
-         uint32_t address = reconstruct_address(line->tag, set_index, 0, cache->index_bits);
-         
-         if (cache == controller->L1) {
-             cache_write(controller->L2, address, line->data);
-         } else if (cache == controller->L2) {
-             controller->memory_accesses++;
+     controller->inclusion_stats.back_invalidations++;
+     if (dirty) controller->inclusion_stats.dirty_back_invalidations++;
+     return dirty;
+ }
+ 
+ // Whether evicting this L2 line must write to memory (back-invalidating first when inclusive)
+ template <typename Controller>
+ static bool l2_victim_needs_write_back(Controller* controller, uint32_t set_index, uint32_t way) {
+     Cache* l2 = controller->L2;
+     if (!cache_line_valid(l2, set_index, way)) return false;
+     bool dirty = cache_line_dirty(l2, set_index, way);
+     if (controller->inclusion == INCLUSION_INCLUSIVE) {
+         uint32_t address = reconstruct_address(cache_line_tag(l2, set_index, way), set_index, 0, l2->index_bits);
+         if (back_invalidate(controller, address)) dirty = true;
+     }
+     return dirty;
+ }
+ 
+ template <typename Controller>
+ static void evict_l2_line(Controller* controller, uint32_t set_index, uint32_t way) {
+     PROFILE_SCOPE(PROFILE_EVICT_L2);
+     if (l2_victim_needs_write_back(controller, set_index, way)) {
+         controller->memory_accesses++;
+         controller->L2->write_backs++;
+     }
+     cache_invalidate_line(controller->L2, set_index, way);
+ }
+ 
+ template <typename Controller>
+ static void demote_to_l2(Controller* controller, uint32_t block_address, uint8_t* data, bool dirty) {
+     Cache* l2 = controller->L2;
+     uint32_t set_index = get_index(block_address, l2->index_bits);
+     if (cache_set_full(l2, set_index)) {
+         evict_l2_line(controller, set_index, get_victim_way(l2, set_index));
+     }
+     cache_insert(l2, block_address, data, dirty);
+     controller->inclusion_stats.demotions++;
+ }
+ 
+ // Exclusive only: remove the L2 copy of a block moving up to L1; returns its dirty bit
+ template <typename Controller>
+ static bool promote_from_l2(Controller* controller, uint32_t address) {
+     if (controller->inclusion != INCLUSION_EXCLUSIVE) return false;
+     Cache* l2 = controller->L2;
+     uint32_t set_index = get_index(address, l2->index_bits);
+     int32_t way = find_block(l2, address & ~((1u << BLOCK_OFFSET_BITS) - 1));
+     if (way < 0) return false;
+     bool dirty = cache_line_dirty(l2, set_index, (uint32_t)way);
+     cache_invalidate_line(l2, set_index, (uint32_t)way);
+     controller->inclusion_stats.promotions++;
+     return dirty;
+ }
+ 
+ /**
+  * Evict an L1 line. With a victim cache every valid line moves there,
+  * dirty data included, and only the line it pushes out goes on to L2;
+  * without one the line goes to L2 directly. Lines reach L2 as write-backs
+  * (dirty only), or as demotions in exclusive mode.
+  */
+ template <typename Controller>
+ static void evict_l1_line(Controller* controller, uint32_t set_index, uint32_t way) {
+     PROFILE_SCOPE(PROFILE_EVICT_L1);
+     Cache* l1 = controller->L1;
+     VictimCache* vc = controller->victim_cache;
+     bool exclusive = controller->inclusion == INCLUSION_EXCLUSIVE;
+     if (cache_line_valid(l1, set_index, way)) {
+         uint32_t address = reconstruct_address(cache_line_tag(l1, set_index, way), set_index, 0, l1->index_bits);
+         bool dirty = cache_line_dirty(l1, set_index, way);
+         uint8_t* line = cache_line_data(l1, set_index, way);
+         if (vc) {
+             VictimLine evicted;
+             if (victim_cache_put(vc, address, line, dirty, &evicted)) {
+                 uint8_t* evicted_data = controller->dataless ? NULL : evicted.data;
+                 if (exclusive) {
+                     demote_to_l2(controller, evicted.block_address, evicted_data, evicted.dirty);
+                 } else if (evicted.dirty) {
+                     cache_write(controller->L2, evicted.block_address, evicted_data);
+                 }
+                 if (evicted.dirty) vc->write_backs++;
+             }
+         } else if (exclusive) {
+             demote_to_l2(controller, address, line, dirty);
+         } else if (dirty) {
+             cache_write(controller->L2, address, line);
          }
-         
-         cache->write_backs++;
+         if (dirty) l1->write_backs++;
+     }
+     cache_invalidate_line(l1, set_index, way);
+ }
+ 
+ /**
+  * Serve an L1 miss from the victim cache: the line swaps places with the
+  * L1 victim of its set. The demand byte is read or written in L1.
+  */
+ template <typename Controller>
+ static bool swap_from_victim_cache(Controller* controller, uint32_t address, uint8_t* data, bool is_write) {
+     VictimCache* vc = controller->victim_cache;
+     uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
+     VictimLine line;
+     if (!vc || !victim_cache_take(vc, block_address, &line)) return false;
+     
+     Cache* l1 = controller->L1;
+     uint32_t set_index = get_index(address, l1->index_bits);
+     if (cache_set_full(l1, set_index)) {
+         evict_l1_line(controller, set_index, get_victim_way(l1, set_index));
+         vc->swaps++;
      }
+     uint32_t way = cache_insert(l1, block_address, controller->dataless ? NULL : line.data,
+                                 line.dirty || is_write);
      
-     line->valid = false;
-     line->dirty = false;
+     uint8_t* bytes = cache_line_data(l1, set_index, way);
+     if (bytes && data) {
+         uint32_t offset = get_offset(address);
+         if (is_write) memcpy(&bytes[offset], data, 1);
+         else memcpy(data, &bytes[offset], 1);
+     }
+     return true;
+ }
+ 
+ void handle_eviction(CacheController* controller, Cache* cache, uint32_t set_index, uint32_t way) {
+     if (cache == controller->L1) {
+         evict_l1_line(controller, set_index, way);
+     } else {
+         evict_l2_line(controller, set_index, way);
+     }
  }
  
-bool controller_read(CacheController* controller, uint32_t address, uint8_t* data) {
+// Train a level's prefetcher on a demand lookup; returns `hit`
+static inline bool observe_lookup(Prefetcher* pf, const Cache* cache, uint32_t address, bool hit) {
+    prefetcher_observe(pf, address, !hit, hit && cache->last_hit_prefetched);
+    return hit;
+}
+
+static ServiceLevel serve_read(CacheController* controller, uint32_t address, uint8_t* data) {
+    if (controller->dataless) data = NULL;
+    
     // First try L1
-    if (cache_read(controller->L1, address, data)) {
-        return true;
+    if (observe_lookup(controller->l1_prefetcher, controller->L1, address,
+                       cache_read(controller->L1, address, data))) {
+        return SERVICE_L1;
+    }
+    
+    if (swap_from_victim_cache(controller, address, data, false)) {
+        return SERVICE_VICTIM;
     }
     
     // L1 miss - try L2
-    uint8_t block_data[L2_BLOCK_SIZE];
-    if (cache_read(controller->L2, address, block_data)) {
+    uint8_t block_storage[L2_BLOCK_SIZE];
+    uint8_t* block_data = controller->dataless ? NULL : block_storage;
+    if (observe_lookup(controller->l2_prefetcher, controller->L2, address,
+                       cache_read(controller->L2, address, block_data))) {
         // L2 hit - allocate in L1
         uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
         uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
+        bool dirty = promote_from_l2(controller, address);
         
         // Check if we need to evict from L1
-        bool need_eviction = true;
-        for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-            if (!controller->L1->sets[l1_set_index][i].valid) {
-                need_eviction = false;
-                break;
-            }
-        }
+        bool need_eviction = cache_set_full(controller->L1, l1_set_index);
         
         if (need_eviction) {
             uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
             handle_eviction(controller, controller->L1, l1_set_index, victim_way);
+            if (controller->inclusion == INCLUSION_EXCLUSIVE) controller->inclusion_stats.swaps++;
         }
         
-        cache_insert(controller->L1, block_address, block_data, false);
+        cache_insert(controller->L1, block_address, block_data, dirty);
         
-        if (data) {
+        if (data && block_data) {
             uint32_t offset = get_offset(address);
             memcpy(data, &block_data[offset], 1);
         }
         
-        return true;
+        return SERVICE_L2;
     }
     
     // Both L1 and L2 missed - access main memory
     controller->memory_accesses++;
     
     // Simulate memory read
-    uint8_t memory_data[L2_BLOCK_SIZE];
-    memset(memory_data, 0xAA, L2_BLOCK_SIZE); // Simulate memory data
+    uint8_t memory_storage[L2_BLOCK_SIZE];
+    uint8_t* memory_data = NULL;
+    if (!controller->dataless) {
+        memory_data = memory_storage;
+        memset(memory_data, 0xAA, L2_BLOCK_SIZE); // Simulate memory data
+    }
     
     uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
     
-    // First insert into L2
-    uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
-    bool need_eviction = true;
-    for (uint32_t i = 0; i < controller->L2->associativity; i++) {
-        if (!controller->L2->sets[l2_set_index][i].valid) {
-            need_eviction = false;
-            break;
+    // First insert into L2 (an exclusive L2 only receives L1 victims)
+    if (controller->inclusion != INCLUSION_EXCLUSIVE) {
+        uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
+        if (cache_set_full(controller->L2, l2_set_index)) {
+            uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
+            handle_eviction(controller, controller->L2, l2_set_index, victim_way);
         }
+        
+        cache_insert(controller->L2, block_address, memory_data, false);
     }
     
-    if (need_eviction) {
-        uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
-        handle_eviction(controller, controller->L2, l2_set_index, victim_way);
-    }
-    
-    cache_insert(controller->L2, block_address, memory_data, false);
-    
     // Then insert into L1
     uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
-    need_eviction = true;
-    for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-        if (!controller->L1->sets[l1_set_index][i].valid) {
-            need_eviction = false;
-            break;
-        }
-    }
+    bool need_eviction = cache_set_full(controller->L1, l1_set_index);
     
     if (need_eviction) {
         uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
@@ -180,84 +496,79 @@ bool controller_read(CacheController* controller, uint32_t address, uint8_t* dat
     
     cache_insert(controller->L1, block_address, memory_data, false);
     
-    if (data) {
+    if (data && memory_data) {
         uint32_t offset = get_offset(address);
         memcpy(data, &memory_data[offset], 1);
     }
     
-    return false;
+    return SERVICE_MEMORY;
 }
 
- bool controller_write(CacheController* controller, uint32_t address, uint8_t* data) {
-     if (cache_write(controller->L1, address, data)) {
-         return true;
+ static ServiceLevel serve_write(CacheController* controller, uint32_t address, uint8_t* data) {
+     if (controller->dataless) data = NULL;
+     
+     if (observe_lookup(controller->l1_prefetcher, controller->L1, address,
+                        cache_write(controller->L1, address, data))) {
+         return SERVICE_L1;
      }
      
-     if (cache_write(controller->L2, address, data)) {
+     if (swap_from_victim_cache(controller, address, data, true)) {
+         return SERVICE_VICTIM;
+     }
+     
+     if (observe_lookup(controller->l2_prefetcher, controller->L2, address,
+                        cache_write(controller->L2, address, data))) {
          uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
          uint32_t l2_tag = get_tag(address, controller->L2->tag_bits, controller->L2->index_bits);
          uint32_t l2_index = get_index(address, controller->L2->index_bits);
          
-         uint8_t block_data[L2_BLOCK_SIZE];
-         for (uint32_t i = 0; i < controller->L2->associativity; i++) {
-             CacheLine* line = &controller->L2->sets[l2_index][i];
-             if (line->valid && line->tag == l2_tag) {
-                 memcpy(block_data, line->data, L2_BLOCK_SIZE);
-                 break;
-             }
+         uint8_t block_storage[L2_BLOCK_SIZE];
+         uint8_t* block_data = controller->dataless ? NULL : block_storage;
+         int32_t l2_way = cache_find_way(controller->L2, l2_index, l2_tag);
+         if (l2_way >= 0 && block_data) {
+             memcpy(block_data, cache_line_data(controller->L2, l2_index, l2_way), L2_BLOCK_SIZE);
          }
+         promote_from_l2(controller, address);
          
          uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
-         bool need_eviction = true;
-         for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-             if (!controller->L1->sets[l1_set_index][i].valid) {
-                 need_eviction = false;
-                 break;
-             }
-         }
+         bool need_eviction = cache_set_full(controller->L1, l1_set_index);
          
          if (need_eviction) {
              uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
              handle_eviction(controller, controller->L1, l1_set_index, victim_way);
+             if (controller->inclusion == INCLUSION_EXCLUSIVE) controller->inclusion_stats.swaps++;
          }
          
          cache_insert(controller->L1, block_address, block_data, true);
-         return true;
+         return SERVICE_L2;
      }
      
      controller->memory_accesses++;
-     uint8_t memory_data[L2_BLOCK_SIZE];
-     memset(memory_data, 0xAA, L2_BLOCK_SIZE);
+     uint8_t memory_storage[L2_BLOCK_SIZE];
+     uint8_t* memory_data = NULL;
+     if (!controller->dataless) {
+         memory_data = memory_storage;
+         memset(memory_data, 0xAA, L2_BLOCK_SIZE);
+     }
      
      uint32_t offset = get_offset(address);
-     memcpy(&memory_data[offset], data, 1);
+     if (memory_data && data) {
+         memcpy(&memory_data[offset], data, 1);
+     }
      
      uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
-     uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
-     
-     bool need_eviction = true;
-     for (uint32_t i = 0; i < controller->L2->associativity; i++) {
-         if (!controller->L2->sets[l2_set_index][i].valid) {
-             need_eviction = false;
-             break;
+     if (controller->inclusion != INCLUSION_EXCLUSIVE) {
+         uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
+         if (cache_set_full(controller->L2, l2_set_index)) {
+             uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
+             handle_eviction(controller, controller->L2, l2_set_index, victim_way);
          }
+         
+         cache_insert(controller->L2, block_address, memory_data, true);
      }
      
-     if (need_eviction) {
-         uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
-         handle_eviction(controller, controller->L2, l2_set_index, victim_way);
-     }
-     
-     cache_insert(controller->L2, block_address, memory_data, true);
-     
      uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
-     need_eviction = true;
-     for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-         if (!controller->L1->sets[l1_set_index][i].valid) {
-             need_eviction = false;
-             break;
-         }
-     }
+     bool need_eviction = cache_set_full(controller->L1, l1_set_index);
      
      if (need_eviction) {
          uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
@@ -265,124 +576,376 @@ bool controller_read(CacheController* controller, uint32_t address, uint8_t* dat
      }
      
      cache_insert(controller->L1, block_address, memory_data, true);
-     return false;
+     return SERVICE_MEMORY;
  }
  
- bool enhanced_read(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
+ static ServiceLevel serve_enhanced_read(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
+     if (controller->dataless) data = NULL;
+     
      if (check_write_buffer(controller->write_buffer, address, data)) {
-         return true;
+         return SERVICE_WRITE_BUFFER;
+     }
+     
+     if (observe_lookup(controller->l1_prefetcher, controller->L1, address,
+                        cache_read(controller->L1, address, data))) {
+         return SERVICE_L1;
      }
      
-     if (cache_read(controller->L1, address, data)) {
-         return true;
+     if (swap_from_victim_cache(controller, address, data, false)) {
+         return SERVICE_VICTIM;
      }
      
-     uint8_t block_data[L2_BLOCK_SIZE];
-     if (cache_read(controller->L2, address, block_data)) {
+     uint8_t block_storage[L2_BLOCK_SIZE];
+     uint8_t* block_data = controller->dataless ? NULL : block_storage;
+     if (observe_lookup(controller->l2_prefetcher, controller->L2, address,
+                        cache_read(controller->L2, address, block_data))) {
          uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
          uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
+         bool dirty = promote_from_l2(controller, address);
          
-         bool need_eviction = true;
-         for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-             if (!controller->L1->sets[l1_set_index][i].valid) {
-                 need_eviction = false;
-                 break;
-             }
-         }
+         bool need_eviction = cache_set_full(controller->L1, l1_set_index);
          
          if (need_eviction) {
              uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
-             CacheLine* victim_line = &controller->L1->sets[l1_set_index][victim_way];
-             if (victim_line->valid && victim_line->dirty) {
-                 uint32_t victim_addr = reconstruct_address(victim_line->tag, l1_set_index, 
-                                                          0, controller->L1->index_bits);
-                 cache_write(controller->L2, victim_addr, victim_line->data);
-                 controller->L1->write_backs++;
-             }
-             victim_line->valid = false;
+             evict_l1_line(controller, l1_set_index, victim_way);
+             if (controller->inclusion == INCLUSION_EXCLUSIVE) controller->inclusion_stats.swaps++;
          }
          
-         cache_insert(controller->L1, block_address, block_data, false);
+         cache_insert(controller->L1, block_address, block_data, dirty);
          
-         if (data) {
+         if (data && block_data) {
              uint32_t offset = get_offset(address);
              memcpy(data, &block_data[offset], 1);
          }
          
-         return true;
+         return SERVICE_L2;
      }
      
      controller->memory_accesses++;
-     uint8_t memory_data[L2_BLOCK_SIZE];
-     memset(memory_data, 0xAA, L2_BLOCK_SIZE);
-     
-     uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
-     uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
-     
-     bool need_eviction = true;
-     for (uint32_t i = 0; i < controller->L2->associativity; i++) {
-         if (!controller->L2->sets[l2_set_index][i].valid) {
-             need_eviction = false;
-             break;
-         }
+     uint8_t memory_storage[L2_BLOCK_SIZE];
+     uint8_t* memory_data = NULL;
+     if (!controller->dataless) {
+         memory_data = memory_storage;
+         memset(memory_data, 0xAA, L2_BLOCK_SIZE);
      }
      
-     if (need_eviction) {
-         uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
-         CacheLine* victim_line = &controller->L2->sets[l2_set_index][victim_way];
-         if (victim_line->valid && victim_line->dirty) {
-             controller->L2->write_backs++;
+     uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
+     if (controller->inclusion != INCLUSION_EXCLUSIVE) {
+         uint32_t l2_set_index = get_index(address, controller->L2->index_bits);
+         if (cache_set_full(controller->L2, l2_set_index)) {
+             uint32_t victim_way = get_victim_way(controller->L2, l2_set_index);
+             evict_l2_line(controller, l2_set_index, victim_way);
          }
-         victim_line->valid = false;
+         
+         cache_insert(controller->L2, block_address, memory_data, false);
      }
      
-     cache_insert(controller->L2, block_address, memory_data, false);
-     
      uint32_t l1_set_index = get_index(address, controller->L1->index_bits);
-     need_eviction = true;
-     for (uint32_t i = 0; i < controller->L1->associativity; i++) {
-         if (!controller->L1->sets[l1_set_index][i].valid) {
-             need_eviction = false;
-             break;
-         }
-     }
+     bool need_eviction = cache_set_full(controller->L1, l1_set_index);
      
      if (need_eviction) {
          uint32_t victim_way = get_victim_way(controller->L1, l1_set_index);
-         CacheLine* victim_line = &controller->L1->sets[l1_set_index][victim_way];
-         if (victim_line->valid && victim_line->dirty) {
-             uint32_t victim_addr = reconstruct_address(victim_line->tag, l1_set_index, 
-                                                      0, controller->L1->index_bits);
-             cache_write(controller->L2, victim_addr, victim_line->data);
-             controller->L1->write_backs++;
-         }
-         victim_line->valid = false;
+         evict_l1_line(controller, l1_set_index, victim_way);
      }
      
      cache_insert(controller->L1, block_address, memory_data, false);
      
-     if (data) {
+     if (data && memory_data) {
          uint32_t offset = get_offset(address);
          memcpy(data, &memory_data[offset], 1);
      }
      
-     return false;
+     return SERVICE_MEMORY;
  }
  
- bool enhanced_write(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
-     insert_write_buffer(controller->write_buffer, address, data);
+ /**
+  * Retire the oldest buffered store. It updates the first level that holds
+  * the block (marking the line dirty there) or goes to memory; the drain
+  * never allocates, and only the level that takes the write sees an access.
+  */
+ static ServiceLevel drain_oldest_write(EnhancedCacheController* controller) {
+     WriteBuffer* wb = controller->write_buffer;
+     const WriteBufferEntry* entry = write_buffer_oldest(wb);
+     if (!entry) return SERVICE_WRITE_BUFFER;
      
-     if (controller->write_buffer->num_entries >= WRITE_BUFFER_SIZE * 0.75) {
-         flush_write_buffer(controller->write_buffer, controller->L1);
+     Cache* levels[2] = { controller->L1, controller->L2 };
+     uint64_t* drains[2] = { &wb->drains_to_l1, &wb->drains_to_l2 };
+     ServiceLevel served[2] = { SERVICE_L1, SERVICE_L2 };
+     ServiceLevel level = SERVICE_MEMORY;
+     bool placed = false;
+     
+     for (int i = 0; i < 2 && !placed; i++) {
+         // A line in the victim cache still belongs to the L1 side
+         VictimCache* vc = controller->victim_cache;
+         int32_t vc_entry = i == 1 && vc ? victim_cache_find(vc, entry->block_address) : -1;
+         if (vc_entry >= 0) {
+             uint8_t* line = victim_cache_line_data(vc, (uint32_t)vc_entry);
+             if (line) merge_write_buffer_entry(entry, line);
+             victim_cache_mark_dirty(vc, (uint32_t)vc_entry);
+             wb->drains_to_l1++;
+             level = SERVICE_VICTIM;
+             placed = true;
+             break;
+         }
+         
+         Cache* cache = levels[i];
+         uint32_t set_index = get_index(entry->block_address, cache->index_bits);
+         uint32_t tag = get_tag(entry->block_address, cache->tag_bits, cache->index_bits);
+         int32_t way = cache_find_way(cache, set_index, tag);
+         if (way < 0) continue;
+         
+         cache_write(cache, entry->block_address, NULL);
+         uint8_t* line = cache_line_data(cache, set_index, (uint32_t)way);
+         if (line) merge_write_buffer_entry(entry, line);
+         (*drains[i])++;
+         level = served[i];
+         placed = true;
+     }
+     
+     if (!placed) {
+         controller->memory_accesses++;
+         wb->drains_to_memory++;
      }
      
+     wb->write_backs++;
+     write_buffer_pop(wb);
+     return level;
+ }
+ 
+ static ServiceLevel serve_enhanced_write(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
+     if (controller->dataless) data = NULL;
+     
+     WriteBuffer* wb = controller->write_buffer;
+     ServiceLevel level = SERVICE_WRITE_BUFFER;
+     if (!insert_write_buffer(wb, address, data)) {
+         // A new block and no free entry: the store waits for the oldest to drain
+         level = drain_oldest_write(controller);
+         wb->full_drains++;
+         insert_write_buffer(wb, address, data);
+     }
+     
+     // Threshold drains happen in the background and cost the store nothing
+     while (wb->num_entries > wb->drain_threshold) {
+         drain_oldest_write(controller);
+     }
+     
+     return level;
+ }
+ 
+ /**
+  * Timing layer: each operation is charged by the level that served it,
+  * which is also kept in last_service for callers. With MSHRs the miss
+  * pipeline decides how long the operation waits (merges, full files);
+  * otherwise it blocks for the level's full latency.
+  */
+ static void account_operation(TimingStats* timing, MissPipeline* pipeline, ServiceLevel* last_service,
+                               bool is_write, uint32_t address, ServiceLevel level) {
+     uint32_t latency;
+     if (miss_pipeline_enabled(pipeline)) {
+         uint32_t block_address = address & ~((1u << BLOCK_OFFSET_BITS) - 1);
+         latency = miss_pipeline_issue(pipeline, &timing->latency, block_address, level);
+         timing->cycles = miss_pipeline_cycles(pipeline);
+     } else {
+         latency = service_latency(&timing->latency, level);
+         timing->cycles += latency;
+     }
+     timing_record(timing, is_write, level, latency);
+     *last_service = level;
+ }
+ 
+ /**
+  * Prefetch issue, shared by both controllers. Candidates queued during a
+  * demand access are issued after it: blocks the target level already holds
+  * are skipped, and with MSHRs a candidate that finds no free entry is
+  * dropped. An L1 candidate is copied from L2 if present (moved, when
+  * exclusive), otherwise it is fetched from memory into the levels a demand
+  * miss would fill. Only the target line is marked prefetched.
+  */
+ template <typename Controller>
+ static void evict_for_prefetch(Controller* controller, Cache* cache, uint32_t set_index, Prefetcher* pf) {
+     if (!cache_set_full(cache, set_index)) return;
+     uint32_t way = get_victim_way(cache, set_index);
+     if (!cache_line_prefetched(cache, set_index, way)) pf->displaced++;
+     if (cache == controller->L1) {
+         evict_l1_line(controller, set_index, way);
+     } else {
+         evict_l2_line(controller, set_index, way);
+     }
+ }
+ 
+ template <typename Controller>
+ static bool held_by_l1_side(const Controller* controller, uint32_t block_address) {
+     return find_block(controller->L1, block_address) >= 0 ||
+            (controller->victim_cache && victim_cache_find(controller->victim_cache, block_address) >= 0);
+ }
+ 
+ template <typename Controller>
+ static void issue_prefetches(Controller* controller, Prefetcher* pf, bool into_l1) {
+     if (!pf) return;
+     Cache* target = into_l1 ? controller->L1 : controller->L2;
+     Cache* l2 = controller->L2;
+     
+     for (uint32_t i = 0; i < pf->num_pending; i++) {
+         uint32_t block_address = pf->pending[i] << BLOCK_OFFSET_BITS;
+         // L1 candidates also skip the victim cache; an exclusive L2 must
+         // not take a copy of a block the L1 side holds either
+         bool exclusive = controller->inclusion == INCLUSION_EXCLUSIVE;
+         if (find_block(target, block_address) >= 0 ||
+             ((into_l1 || exclusive) && held_by_l1_side(controller, block_address))) {
+             pf->redundant++;
+             continue;
+         }
+         
+         int32_t l2_way = into_l1 ? find_block(l2, block_address) : -1;
+         ServiceLevel source = l2_way >= 0 ? SERVICE_L2 : SERVICE_MEMORY;
+         if (miss_pipeline_enabled(&controller->pipeline) &&
+             !miss_pipeline_prefetch(&controller->pipeline, &controller->timing.latency,
+                                     block_address, into_l1, source)) {
+             pf->dropped++;
+             continue;
+         }
+         
+         uint8_t block_storage[L2_BLOCK_SIZE];
+         uint8_t* block_data = NULL;
+         if (!controller->dataless) {
+             block_data = block_storage;
+             if (l2_way >= 0) {
+                 uint32_t l2_set = get_index(block_address, l2->index_bits);
+                 memcpy(block_data, cache_line_data(l2, l2_set, (uint32_t)l2_way), L2_BLOCK_SIZE);
+             } else {
+                 memset(block_data, 0xAA, L2_BLOCK_SIZE);
+             }
+         }
+         
+         bool dirty = false;
+         if (source == SERVICE_L2) {
+             dirty = promote_from_l2(controller, block_address);
+         } else {
+             controller->memory_accesses++;
+             pf->memory_fetches++;
+             if (into_l1 && !exclusive) {
+                 evict_for_prefetch(controller, l2, get_index(block_address, l2->index_bits), pf);
+                 cache_insert(l2, block_address, block_data, false);
+             }
+         }
+         
+         uint32_t set_index = get_index(block_address, target->index_bits);
+         evict_for_prefetch(controller, target, set_index, pf);
+         uint32_t way = cache_insert(target, block_address, block_data, dirty);
+         cache_mark_prefetched(target, set_index, way);
+         pf->fills++;
+     }
+     pf->num_pending = 0;
+ }
+ 
+ template <typename Controller>
+ static void run_prefetchers(Controller* controller) {
+     issue_prefetches(controller, controller->l1_prefetcher, true);
+     issue_prefetches(controller, controller->l2_prefetcher, false);
+ }
+ 
+ bool controller_read(CacheController* controller, uint32_t address, uint8_t* data) {
+     ServiceLevel level = serve_read(controller, address, data);
+     account_operation(&controller->timing, &controller->pipeline, &controller->last_service, false,
+                       address, level);
+     run_prefetchers(controller);
+     return level != SERVICE_MEMORY;
+ }
+ 
+ bool controller_write(CacheController* controller, uint32_t address, uint8_t* data) {
+     ServiceLevel level = serve_write(controller, address, data);
+     account_operation(&controller->timing, &controller->pipeline, &controller->last_service, true,
+                       address, level);
+     run_prefetchers(controller);
+     return level != SERVICE_MEMORY;
+ }
+ 
+ bool enhanced_read(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
+     ServiceLevel level = serve_enhanced_read(controller, address, data);
+     account_operation(&controller->timing, &controller->pipeline, &controller->last_service, false,
+                       address, level);
+     run_prefetchers(controller);
+     return level != SERVICE_MEMORY;
+ }
+ 
+ bool enhanced_write(EnhancedCacheController* controller, uint32_t address, uint8_t* data) {
+     ServiceLevel level = serve_enhanced_write(controller, address, data);
+     account_operation(&controller->timing, &controller->pipeline, &controller->last_service, true,
+                       address, level);
+     run_prefetchers(controller);
      return true;
  }
  
+ void drain_write_buffer(EnhancedCacheController* controller) {
+     while (controller->write_buffer->num_entries > 0) {
+         drain_oldest_write(controller);
+     }
+ }
+ 
+ static void print_inclusion_stats(InclusionPolicy inclusion, const InclusionStats* stats) {
+     if (inclusion == INCLUSION_NINE) return;
+     printf("===== Inclusion (%s) =====\n", inclusion_policy_name(inclusion));
+     if (inclusion == INCLUSION_INCLUSIVE) {
+         printf("Back-invalidations: %llu (dirty, written to memory: %llu)\n",
+                (unsigned long long)stats->back_invalidations,
+                (unsigned long long)stats->dirty_back_invalidations);
+     } else {
+         printf("Promotions from L2: %llu, swaps with an L1 victim: %llu\n",
+                (unsigned long long)stats->promotions, (unsigned long long)stats->swaps);
+         printf("L1 victims moved to L2: %llu\n", (unsigned long long)stats->demotions);
+     }
+     printf("===========================\n");
+ }
+ 
+ template <typename Controller>
+ static void print_level_prefetch_stats(const Controller* controller) {
+     const MissPipeline* pipeline = &controller->pipeline;
+     bool timed = miss_pipeline_enabled(pipeline);
+     if (controller->l1_prefetcher) {
+         const Cache* l1 = controller->L1;
+         print_prefetch_stats("L1", controller->l1_prefetcher, l1->prefetch_hits, l1->prefetch_unused,
+                              l1->misses, timed, timed ? pipeline->l1->late_prefetches : 0);
+     }
+     if (controller->l2_prefetcher) {
+         const Cache* l2 = controller->L2;
+         print_prefetch_stats("L2", controller->l2_prefetcher, l2->prefetch_hits, l2->prefetch_unused,
+                              l2->misses, timed, timed ? pipeline->l2->late_prefetches : 0);
+     }
+ }
+ 
+ void print_l2_bank_stats(const Cache* l2, const MissPipeline* pipeline) {
+     bool timed = pipeline && miss_pipeline_enabled(pipeline) && pipeline->banks.busy_cycles > 0;
+     if (!l2->bank_accesses && !timed) return;
+     printf("===== L2 Bank Statistics =====\n");
+     printf("Banks: %u (interleaved by the low index bits)", l2->num_banks);
+     if (timed) printf(", %u busy cycles per lookup", pipeline->banks.busy_cycles);
+     printf("\n");
+     for (uint32_t b = 0; b < l2->num_banks; b++) {
+         uint64_t accesses = l2->bank_accesses ? l2->bank_accesses[b] : l2->accesses;
+         printf("Bank %2u: %llu accesses (%.2f%%)", b, (unsigned long long)accesses,
+                l2->accesses > 0 ? (double)accesses / l2->accesses * 100 : 0);
+         if (timed) {
+             printf(", %llu conflicts, %llu stall cycles", (unsigned long long)pipeline->banks.conflicts[b],
+                    (unsigned long long)pipeline->banks.stall_cycles[b]);
+         }
+         printf("\n");
+     }
+     printf("==============================\n");
+ }
+ 
  void print_controller_stats(CacheController* controller) {
     print_cache_stats(controller->L1, "L1 Cache");
     print_cache_stats(controller->L2, "L2 Cache");
     printf("Memory accesses: %llu\n", controller->memory_accesses);
+    print_timing_stats(&controller->timing, controller->victim_cache != NULL);
+    print_mshr_stats(&controller->pipeline);
+    print_level_prefetch_stats(controller);
+    if (controller->victim_cache) {
+        print_victim_cache_stats(controller->victim_cache, controller->timing.latency.victim,
+                                 controller->L1->misses);
+    }
+    print_l2_bank_stats(controller->L2, &controller->pipeline);
+    print_inclusion_stats(controller->inclusion, &controller->inclusion_stats);
 }
 
 void print_enhanced_stats(EnhancedCacheController* controller) {
@@ -390,9 +953,118 @@ void print_enhanced_stats(EnhancedCacheController* controller) {
     print_cache_stats(controller->L2, "L2 Cache");
     
     printf("===== Write Buffer Statistics =====\n");
-    printf("Write-backs: %llu\n", controller->write_buffer->write_backs);
-    printf("Coalesced writes: %llu\n", controller->write_buffer->coalesced_writes);
+    const WriteBuffer* wb = controller->write_buffer;
+    printf("Depth: %u entries, drains above %u\n", wb->depth, wb->drain_threshold);
+    printf("Write-backs: %llu (L1 %llu, L2 %llu, memory %llu)\n",
+           (unsigned long long)wb->write_backs, (unsigned long long)wb->drains_to_l1,
+           (unsigned long long)wb->drains_to_l2, (unsigned long long)wb->drains_to_memory);
+    printf("Drains forced by a full buffer: %llu\n", (unsigned long long)wb->full_drains);
+    printf("Coalesced writes: %llu\n", (unsigned long long)wb->coalesced_writes);
+    printf("Forwarded reads: %llu\n", (unsigned long long)wb->forwarded_reads);
     printf("==================================\n");
     
     printf("Memory accesses: %llu\n", controller->memory_accesses);
-}
\ No newline at end of file
+    print_timing_stats(&controller->timing, controller->victim_cache != NULL);
+    print_mshr_stats(&controller->pipeline);
+    print_level_prefetch_stats(controller);
+    if (controller->victim_cache) {
+        print_victim_cache_stats(controller->victim_cache, controller->timing.latency.victim,
+                                 controller->L1->misses);
+    }
+    print_l2_bank_stats(controller->L2, &controller->pipeline);
+    print_inclusion_stats(controller->inclusion, &controller->inclusion_stats);
+}
+/**
+ * Registry hookup, shared by both controllers: the counters behind the
+ * text report, grouped the same way. Optional components register only
+ * when they exist, so the columns follow the configuration.
+ */
+static bool register_mshr_file(StatsRegistry* registry, const char* prefix, const MshrFile* file) {
+    return stats_register(registry, prefix, "allocations", &file->allocations) &&
+           stats_register(registry, prefix, "merges", &file->merges) &&
+           stats_register(registry, prefix, "full_stalls", &file->full_stalls) &&
+           stats_register(registry, prefix, "stall_cycles", &file->stall_cycles) &&
+           stats_register(registry, prefix, "prefetches", &file->prefetches) &&
+           stats_register(registry, prefix, "late_prefetches", &file->late_prefetches);
+}
+
+static bool register_prefetcher(StatsRegistry* registry, const char* prefix, const Prefetcher* pf) {
+    if (!pf) return true;
+    return stats_register(registry, prefix, "issued", &pf->issued) &&
+           stats_register(registry, prefix, "redundant", &pf->redundant) &&
+           stats_register(registry, prefix, "dropped", &pf->dropped) &&
+           stats_register(registry, prefix, "fills", &pf->fills) &&
+           stats_register(registry, prefix, "memory_fetches", &pf->memory_fetches) &&
+           stats_register(registry, prefix, "displaced", &pf->displaced);
+}
+
+template <typename Controller>
+static bool register_hierarchy_stats(StatsRegistry* registry, Controller* controller) {
+    static const char* const served_names[SERVICE_LEVELS] = {
+        "served.write_buffer", "served.l1", "served.victim", "served.l2", "served.memory"
+    };
+    const TimingStats* timing = &controller->timing;
+    bool ok = stats_register_cache(registry, "l1", controller->L1) &&
+              stats_register_cache(registry, "l2", controller->L2) &&
+              stats_register(registry, "", "memory_accesses", &controller->memory_accesses) &&
+              stats_register(registry, "timing", "cycles", &timing->cycles) &&
+              stats_register(registry, "timing", "read_ops", &timing->read_ops) &&
+              stats_register(registry, "timing", "write_ops", &timing->write_ops) &&
+              stats_register(registry, "timing", "read_cycles", &timing->read_cycles) &&
+              stats_register(registry, "timing", "write_cycles", &timing->write_cycles);
+    for (int level = 0; ok && level < SERVICE_LEVELS; level++) {
+        ok = stats_register(registry, "timing", served_names[level], &timing->served[level]);
+    }
+
+    const MissPipeline* pipeline = &controller->pipeline;
+    if (ok && miss_pipeline_enabled(pipeline)) {
+        ok = register_mshr_file(registry, "mshr.l1", pipeline->l1) &&
+             register_mshr_file(registry, "mshr.l2", pipeline->l2);
+        for (uint32_t b = 0; ok && pipeline->banks.busy_cycles > 0 && b < pipeline->banks.count; b++) {
+            char prefix[32];
+            snprintf(prefix, sizeof(prefix), "l2.bank%u", b);
+            ok = stats_register(registry, prefix, "conflicts", &pipeline->banks.conflicts[b]) &&
+                 stats_register(registry, prefix, "stall_cycles", &pipeline->banks.stall_cycles[b]);
+        }
+    }
+
+    ok = ok && register_prefetcher(registry, "prefetch.l1", controller->l1_prefetcher) &&
+         register_prefetcher(registry, "prefetch.l2", controller->l2_prefetcher);
+
+    const VictimCache* vc = controller->victim_cache;
+    if (ok && vc) {
+        ok = stats_register(registry, "victim_cache", "probes", &vc->probes) &&
+             stats_register(registry, "victim_cache", "hits", &vc->hits) &&
+             stats_register(registry, "victim_cache", "swaps", &vc->swaps) &&
+             stats_register(registry, "victim_cache", "fills", &vc->fills) &&
+             stats_register(registry, "victim_cache", "evictions", &vc->evictions) &&
+             stats_register(registry, "victim_cache", "write_backs", &vc->write_backs);
+    }
+
+    const InclusionStats* inclusion = &controller->inclusion_stats;
+    if (ok && controller->inclusion != INCLUSION_NINE) {
+        ok = stats_register(registry, "inclusion", "back_invalidations", &inclusion->back_invalidations) &&
+             stats_register(registry, "inclusion", "dirty_back_invalidations",
+                            &inclusion->dirty_back_invalidations) &&
+             stats_register(registry, "inclusion", "promotions", &inclusion->promotions) &&
+             stats_register(registry, "inclusion", "swaps", &inclusion->swaps) &&
+             stats_register(registry, "inclusion", "demotions", &inclusion->demotions);
+    }
+    return ok;
+}
+
+bool register_controller_stats(StatsRegistry* registry, CacheController* controller) {
+    return register_hierarchy_stats(registry, controller);
+}
+
+bool register_enhanced_stats(StatsRegistry* registry, EnhancedCacheController* controller) {
+    const WriteBuffer* wb = controller->write_buffer;
+    return register_hierarchy_stats(registry, controller) &&
+           stats_register(registry, "write_buffer", "write_backs", &wb->write_backs) &&
+           stats_register(registry, "write_buffer", "drains_to_l1", &wb->drains_to_l1) &&
+           stats_register(registry, "write_buffer", "drains_to_l2", &wb->drains_to_l2) &&
+           stats_register(registry, "write_buffer", "drains_to_memory", &wb->drains_to_memory) &&
+           stats_register(registry, "write_buffer", "full_drains", &wb->full_drains) &&
+           stats_register(registry, "write_buffer", "coalesced_writes", &wb->coalesced_writes) &&
+           stats_register(registry, "write_buffer", "forwarded_reads", &wb->forwarded_reads);
+}
@@ -6,68 +6,389 @@
  #include "cache.h"
  #include "controller.h"
  #include "trace_parser.h"
+ #include "trace_binary.h"
+ #include "stack_distance.h"
+ #include "sweep.h"
+ #include "parallel.h"
+ #include "config.h"
+ #include "multicore.h"
+ #include "cache_analysis.h"
  #include <stdio.h>
  #include <stdlib.h>
- #include <time.h>
  #include <string.h>
  
+ static void print_usage(const char* prog) {
+     printf("Usage: %s [-e] [-t] [-s] [-p shards] [-m rr|time] <trace_file1> [trace_file2 ...]\n", prog);
+     printf("  -e  Use the enhanced controller with write buffer\n");
+     printf("  -t  Tag-only simulation: track hits/misses without block data\n");
+     printf("  -s  Stack-distance mode: LRU miss curves for every size and associativity\n");
+     printf("  -p  Split the sets into N shards simulated on N threads (basic controller);\n");
+     printf("      \"-p banks\" runs one shard per L2 bank\n");
+     printf("  -m  Multi-core: one core per trace, private L1s kept coherent with MESI\n");
+     printf("      and a shared L2; traces interleave round-robin or by core clock\n");
+     printf("  --config FILE        Read key = value settings (same keys as below)\n");
+     printf("  --l1-size SIZE       L1 capacity, e.g. 32K (default %uK)\n", L1_SIZE >> 10);
+     printf("  --l1-assoc N         L1 associativity (default %u)\n", L1_ASSOCIATIVITY);
+     printf("  --l2-size SIZE       L2 capacity (default %uK)\n", L2_SIZE >> 10);
+     printf("  --l2-assoc N         L2 associativity (default %u)\n", L2_ASSOCIATIVITY);
+     printf("  --policy P           Replacement policy for both levels: lru, random,\n");
+     printf("                       fifo, plru, srrip, brrip, drrip\n");
+     printf("  --l1-policy P, --l2-policy P\n");
+     printf("  --wb-depth N         Write buffer entries with -e (default %d)\n", WRITE_BUFFER_SIZE);
+     printf("  --wb-drain N         Entries kept before the oldest drain (default %d)\n",
+            WRITE_BUFFER_DRAIN_THRESHOLD);
+     printf("  --l1-latency N, --l2-latency N, --wb-latency N, --mem-latency N\n");
+     printf("                       Cycles charged at each level (defaults %d/%d/%d/%d)\n",
+            L1_HIT_LATENCY, L2_HIT_LATENCY, WRITE_BUFFER_LATENCY, MEMORY_LATENCY);
+     printf("  --victim-latency N   Extra cycles after an L1 miss for a victim cache hit (default %d)\n",
+            VICTIM_CACHE_LATENCY);
+     printf("  --l1-mshrs N, --l2-mshrs N  Outstanding misses per level (defaults %d/%d);\n",
+            L1_MSHR_ENTRIES, L2_MSHR_ENTRIES);
+     printf("                       --mshrs 0 makes every access block\n");
+     printf("  --l2-banks N         Interleave the L2 sets over N banks, up to %d (default 1)\n", MAX_CACHE_BANKS);
+     printf("  --l2-bank-busy N     Cycles an L2 lookup holds its bank with MSHRs (default 0, none)\n");
+     printf("  --inclusion M        L1/L2 contents: nine (default), inclusive, exclusive\n");
+     printf("  --victim-entries N   Victim cache between L1 and L2, %d-%d entries (default 0, off)\n",
+            VICTIM_CACHE_MIN_ENTRIES, VICTIM_CACHE_MAX_ENTRIES);
+     printf("  --l1-prefetch P, --l2-prefetch P\n");
+     printf("                       Hardware prefetcher: none, next-line, stride, stream\n");
+     printf("  --prefetch-degree N  Blocks fetched per trigger, 1-%d (default %d)\n",
+            PREFETCH_MAX_DEGREE, PREFETCH_DEFAULT_DEGREE);
+     printf("  --classify-misses on Split misses into compulsory, capacity and conflict\n");
+     printf("  --heat-map FILE      Write per-set accesses, misses and evictions as CSV\n");
+     printf("  --stats-file FILE    Write every counter as JSON or CSV (--stats-format json|csv)\n");
+     printf("  --stats-interval N   Also snapshot the counters every N records (default 0, off)\n");
+     printf("  --progress N         Print a progress line every N records (default 0, off)\n");
+     printf("  --seed N             Seed for random replacement (default %d)\n", DEFAULT_RANDOM_SEED);
+     printf("With no trace files a built-in workload is simulated instead:\n");
+     printf("  --workload P         sequential (default), strided, random, zipf, pointer-chase\n");
+     printf("  --workload-footprint SIZE, --workload-stride SIZE\n");
+     printf("                       Region and slot size, powers of two (defaults %uK, %d)\n",
+            WORKLOAD_DEFAULT_FOOTPRINT >> 10, WORKLOAD_DEFAULT_STRIDE);
+     printf("  --workload-accesses N, --workload-writes PCT, --workload-seed N\n");
+     printf("                       Length, store percentage and seed (defaults %llu, %d%%, 1)\n",
+            (unsigned long long)WORKLOAD_DEFAULT_ACCESSES, WORKLOAD_DEFAULT_WRITES);
+     printf("A trace file of \"-\" reads from stdin; FIFOs are streamed as well.\n");
+     printf("       %s convert <input_trace> <output_trace>\n", prog);
+     printf("  Convert a trace to the compact binary format (\"-\" for stdin/stdout).\n");
+     printf("  Binary traces are detected automatically when simulating.\n");
+     printf("       %s sweep [options] <trace_file1> [trace_file2 ...]\n", prog);
+     printf("  Simulate a grid of configurations in parallel (see '%s sweep').\n", prog);
+ }
+ 
+ // Policies whose state spans sets (random stream, PSEL), which shards cannot split
+ static bool policy_uses_shared_state(ReplacementPolicy policy) {
+     return policy == RANDOM || policy == BRRIP || policy == DRRIP;
+ }
+ 
+ // Per-set counters of a two-level run, if --heat-map asked for them
+ static bool write_level_heat_map(const ControllerConfig* config, const Cache* l1, const Cache* l2) {
+     if (config->heat_map[0] == '\0') return true;
+     const Cache* caches[] = { l1, l2 };
+     const char* names[] = { "L1", "L2" };
+     if (!write_set_heat_map(config->heat_map, caches, names, 2)) return false;
+     printf("Per-set heat map written to %s\n", config->heat_map);
+     return true;
+ }
+ 
+ // Write the final values of --stats-file, if any, and release the registry
+ static bool finish_stats(StatsRegistry* stats, uint64_t records) {
+     if (!stats) return true;
+     bool ok = stats_finish(stats, records);
+     if (ok) printf("Statistics written to %s\n", stats->filename);
+     free_stats_registry(stats);
+     return ok;
+ }
+ 
  int main(int argc, char** argv) {
+    // Subcommands run before the banner so "convert ... -" can write to stdout
+    if (argc > 1 && strcmp(argv[1], "convert") == 0) {
+        if (argc != 4) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return convert_trace_to_binary(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "sweep") == 0) {
+        return sweep_main(argc, argv);
+    }
+    
     printf("2-Level Cache Controller\n");
     printf("========================\n");
     
-    srand(time(NULL));
-    
     bool use_enhanced = false;
+    bool stack_distance = false;
+    uint32_t shards = 1;
+    bool shard_per_bank = false;
+    bool multicore = false;
+    InterleavePolicy interleave = INTERLEAVE_ROUND_ROBIN;
+    ControllerConfig config;
+    default_controller_config(&config);
     int arg_start = 1;
     
-    if (argc > 1 && strcmp(argv[1], "-e") == 0) {
-        use_enhanced = true;
-        arg_start = 2;
+    // A lone "-" is not an option: it names stdin as the trace
+    while (arg_start < argc && argv[arg_start][0] == '-' && argv[arg_start][1] != '\0') {
+        if (strcmp(argv[arg_start], "-e") == 0) {
+            use_enhanced = true;
+        } else if (strcmp(argv[arg_start], "-t") == 0) {
+            config.dataless = true;
+        } else if (strcmp(argv[arg_start], "-s") == 0) {
+            stack_distance = true;
+        } else if (strcmp(argv[arg_start], "-p") == 0 && arg_start + 1 < argc) {
+            arg_start++;
+            shard_per_bank = strcmp(argv[arg_start], "banks") == 0;
+            if (!shard_per_bank) {
+                char* end;
+                unsigned long v = strtoul(argv[arg_start], &end, 10);
+                if (end == argv[arg_start] || *end != '\0' || v == 0 || v > UINT32_MAX ||
+                    (v & (v - 1)) != 0) {
+                    fprintf(stderr, "Invalid shard count: %s\n", argv[arg_start]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                shards = (uint32_t)v;
+            }
+        } else if (strcmp(argv[arg_start], "-m") == 0 && arg_start + 1 < argc) {
+            if (!parse_interleave_policy(argv[++arg_start], &interleave)) {
+                fprintf(stderr, "Unknown interleaving: %s (expected rr or time)\n", argv[arg_start]);
+                return 1;
+            }
+            multicore = true;
+        } else if (strcmp(argv[arg_start], "--config") == 0 && arg_start + 1 < argc) {
+            if (!load_config_file(&config, argv[++arg_start])) return 1;
+        } else if (strncmp(argv[arg_start], "--", 2) == 0 && arg_start + 1 < argc) {
+            // Settings apply in order, so later options override a config file
+            if (!apply_config_option(&config, argv[arg_start] + 2, argv[arg_start + 1])) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            arg_start++;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[arg_start]);
+            print_usage(argv[0]);
+            return 1;
+        }
+        arg_start++;
+    }
+    
+    if (!finalize_controller_config(&config)) {
+        return 1;
+    }
+    
+    if (shard_per_bank) {
+        // Banks interleave by the low index bits, exactly as shards do
+        shards = config.l2.banks;
+    }
+    
+    if (config.dataless) {
+        printf("Tag-only mode: block data is not simulated\n");
+    }
+    
+    if (shards != 1 && (use_enhanced || stack_distance)) {
+        fprintf(stderr, "-p only applies to the basic controller\n");
+        return 1;
+    }
+    
+    if (shards != 1 && (config.l1_prefetch != PREFETCH_NONE || config.l2_prefetch != PREFETCH_NONE)) {
+        // Prefetch candidates may belong to another shard's sets
+        fprintf(stderr, "-p cannot be combined with prefetching\n");
+        return 1;
+    }
+    
+    if (shards != 1 && config.victim_entries > 0) {
+        // The victim cache is shared by every L1 set
+        fprintf(stderr, "-p cannot be combined with a victim cache\n");
+        return 1;
+    }
+    
+    if (shards != 1 && (policy_uses_shared_state(config.l1.policy) ||
+                        policy_uses_shared_state(config.l2.policy))) {
+        // Each shard has its own random stream and PSEL, and DRRIP's leader
+        // sets end up split across shards, so results differ from the serial run
+        fprintf(stderr, "-p cannot be combined with random, brrip or drrip replacement\n");
+        return 1;
+    }
+    
+    if (shards != 1 && (config.l1.classify_misses || config.l2.classify_misses)) {
+        // The shadow fully-associative cache spans every set
+        fprintf(stderr, "-p cannot be combined with --classify-misses\n");
+        return 1;
+    }
+    
+    if (shards != 1 && config.stats_interval > 0) {
+        // Shards run ahead of each other, so there is no common point to sample
+        fprintf(stderr, "-p cannot be combined with --stats-interval\n");
+        return 1;
+    }
+    
+    if (shards != 1 && arg_start >= argc) {
+        // Shards replay files; the built-in workloads are generated serially
+        fprintf(stderr, "-p needs trace files\n");
+        return 1;
+    }
+    
+    if (shards != 1 && config.l1_mshrs != 0) {
+        // MSHRs are shared by every set, so shards cannot model them
+        printf("Sharded runs use the blocking timing model (--mshrs 0)\n");
+        config.l1_mshrs = 0;
+        config.l2_mshrs = 0;
+    }
+    
+    if (multicore && (use_enhanced || stack_distance || shards != 1)) {
+        fprintf(stderr, "-m cannot be combined with -e, -s or -p\n");
+        return 1;
+    }
+    
+    if (multicore && (config.l1_prefetch != PREFETCH_NONE || config.l2_prefetch != PREFETCH_NONE ||
+                      config.victim_entries > 0 || config.inclusion != INCLUSION_NINE)) {
+        // Cores only model the MESI L1s over a non-inclusive shared L2
+        fprintf(stderr, "-m cannot be combined with prefetching, a victim cache or --inclusion\n");
+        return 1;
+    }
+    
+    if (multicore && config.l1_mshrs != 0) {
+        printf("Multi-core runs use the blocking timing model (--mshrs 0)\n");
+        config.l1_mshrs = 0;
+        config.l2_mshrs = 0;
+    }
+    
+    if (stack_distance) {
+        if (arg_start >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        
+        StackDistanceProfile* profile = create_stack_distance_profile();
+        if (!profile) {
+            fprintf(stderr, "Failed to create stack-distance profile\n");
+            return 1;
+        }
+        
+        for (int i = arg_start; i < argc; i++) {
+            printf("\nProcessing trace file: %s\n", argv[i]);
+            process_usimm_trace_stack_distance(profile, argv[i]);
+        }
+        
+        print_stack_distance_report(profile);
+        free_stack_distance_profile(profile);
+        return 0;
+    }
+    
+    print_controller_config(&config);
+    
+    StatsRegistry* stats = NULL;
+    if (config.stats_file[0] != '\0') {
+        stats = create_stats_registry(config.stats_file, config.stats_format, config.stats_interval);
+        if (!stats) return 1;
+    }
+    TraceRun run = { config.progress_interval, stats, 0 };
+    
+    if (multicore) {
+        MultiCoreSystem* system = arg_start < argc
+            ? create_multicore_system(&config, (uint32_t)(argc - arg_start), interleave) : NULL;
+        if (!system || (stats && !register_multicore_stats(stats, system))) {
+            if (arg_start >= argc) print_usage(argv[0]);
+            else fprintf(stderr, "Failed to create multi-core system\n");
+            free_multicore_system(system);
+            free_stats_registry(stats);
+            return 1;
+        }
+        
+        int status = process_multicore_traces(system, (const char* const*)&argv[arg_start], &run);
+        if (status == 0) {
+            printf("\nFinal Statistics:\n");
+            print_multicore_stats(system);
+        }
+        if (status == 0 && config.heat_map[0] != '\0') {
+            const Cache* caches[MULTICORE_MAX_CORES + 1];
+            char names[MULTICORE_MAX_CORES + 1][16];
+            const char* name_list[MULTICORE_MAX_CORES + 1];
+            for (uint32_t i = 0; i <= system->num_cores; i++) {
+                bool shared = i == system->num_cores;
+                caches[i] = shared ? system->L2 : system->cores[i].l1;
+                if (shared) snprintf(names[i], sizeof(names[i]), "L2");
+                else snprintf(names[i], sizeof(names[i]), "Core%u-L1", i);
+                name_list[i] = names[i];
+            }
+            if (write_set_heat_map(config.heat_map, caches, name_list, system->num_cores + 1)) {
+                printf("Per-set heat map written to %s\n", config.heat_map);
+            } else {
+                status = -1;
+            }
+        }
+        if (!finish_stats(stats, run.records)) status = -1;
+        free_multicore_system(system);
+        return status == 0 ? 0 : 1;
     }
     
     if (use_enhanced) {
         printf("Using enhanced cache controller with write buffer\n");
-        EnhancedCacheController* controller = create_enhanced_controller();
-        if (!controller) {
+        EnhancedCacheController* controller = create_enhanced_controller(&config);
+        if (!controller || (stats && !register_enhanced_stats(stats, controller))) {
             fprintf(stderr, "Failed to create enhanced controller\n");
+            free_enhanced_controller(controller);
+            free_stats_registry(stats);
             return 1;
         }
          
-         if (argc < 3) {
-             printf("Usage: %s -e <trace_file1> [trace_file2 ...]\n", argv[0]);
+         bool written = true;
+         if (arg_start >= argc) {
              printf("No trace files provided. Running built-in test patterns.\n");
-             
-             // Test patterns would go here
-             free_enhanced_controller(controller);
-             return 0;
+             written = process_workload_enhanced(controller, &config.workload, &run) == 0;
          }
          
          for (int i = arg_start; i < argc; i++) {
              printf("\nProcessing trace file: %s\n", argv[i]);
-             process_usimm_trace_enhanced(controller, argv[i]);
+             process_usimm_trace_enhanced(controller, argv[i], &run);
          }
          
+         written = written && write_level_heat_map(&config, controller->L1, controller->L2);
+         written = finish_stats(stats, run.records) && written;
          free_enhanced_controller(controller);
+         if (!written) return 1;
      } else {
          printf("Using basic cache controller\n");
-         CacheController* controller = create_cache_controller();
+         CacheController* controller = create_cache_controller(&config);
+         if (!controller || (stats && !register_controller_stats(stats, controller))) {
+             fprintf(stderr, "Failed to create cache controller\n");
+             free_cache_controller(controller);
+             free_stats_registry(stats);
+             return 1;
+         }
          
-         if (argc < 2) {
-             printf("Usage: %s <trace_file1> [trace_file2 ...]\n", argv[0]);
-             printf("No trace files provided. Running built-in test patterns.\n");
-             
-             // Test patterns would go here
+         if (shards != 1) {
+             // Shards keep their own caches; this controller only collects the totals
+             int status = process_usimm_trace_sharded(controller, &config,
+                                                      (const char* const*)&argv[arg_start],
+                                                      argc - arg_start, shards);
+             if (status == 0) {
+                 printf("\nFinal Statistics:\n");
+                 print_controller_stats(controller);
+                 if (!write_level_heat_map(&config, controller->L1, controller->L2)) status = -1;
+             }
+             // Every record is one timed operation of some shard
+             uint64_t records = controller->timing.read_ops + controller->timing.write_ops;
+             if (!finish_stats(stats, records)) status = -1;
              free_cache_controller(controller);
-             return 0;
+             return status == 0 ? 0 : 1;
+         }
+         
+         bool written = true;
+         if (arg_start >= argc) {
+             printf("No trace files provided. Running built-in test patterns.\n");
+             written = process_workload(controller, &config.workload, &run) == 0;
          }
          
          for (int i = arg_start; i < argc; i++) {
              printf("\nProcessing trace file: %s\n", argv[i]);
-             process_usimm_trace(controller, argv[i]);
+             process_usimm_trace(controller, argv[i], &run);
          }
          
+         written = written && write_level_heat_map(&config, controller->L1, controller->L2);
+         written = finish_stats(stats, run.records) && written;
          free_cache_controller(controller);
+         if (!written) return 1;
      }
      
      return 0;
- }
\ No newline at end of file
+ }
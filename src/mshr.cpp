@@ -0,0 +1,219 @@
+/**
+ * mshr.cpp
+ * Miss status holding registers and the non-blocking issue model
+ */
+
+#include "mshr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static MshrFile* create_mshr_file(uint32_t capacity) {
+    MshrFile* file = (MshrFile*)calloc(1, sizeof(MshrFile));
+    if (file) file->capacity = capacity;
+    return file;
+}
+
+bool init_miss_pipeline(MissPipeline* pipeline, uint32_t l1_entries, uint32_t l2_entries,
+                        uint32_t l2_banks, uint32_t bank_busy_cycles) {
+    pipeline->l1 = NULL;
+    pipeline->l2 = NULL;
+    pipeline->now = 0;
+    pipeline->finish = 0;
+    memset(&pipeline->banks, 0, sizeof(pipeline->banks));
+    pipeline->banks.count = l2_banks;
+    pipeline->banks.busy_cycles = bank_busy_cycles;
+    if (l2_banks == 0 || l2_banks > MAX_CACHE_BANKS) return false;
+    if (l1_entries == 0 || l2_entries == 0) return true;
+    if (l1_entries > MAX_MSHR_ENTRIES || l2_entries > MAX_MSHR_ENTRIES) return false;
+
+    pipeline->l1 = create_mshr_file(l1_entries);
+    pipeline->l2 = create_mshr_file(l2_entries);
+    if (!pipeline->l1 || !pipeline->l2) {
+        free_miss_pipeline(pipeline);
+        return false;
+    }
+    return true;
+}
+
+void free_miss_pipeline(MissPipeline* pipeline) {
+    free(pipeline->l1);
+    free(pipeline->l2);
+    pipeline->l1 = NULL;
+    pipeline->l2 = NULL;
+}
+
+// Release every entry whose block has arrived by `now`
+static void retire_mshrs(MshrFile* file, uint64_t now) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < file->count; i++) {
+        if (file->entries[i].ready_cycle > now) {
+            file->entries[kept++] = file->entries[i];
+        }
+    }
+    file->count = kept;
+}
+
+static MshrEntry* find_mshr(MshrFile* file, uint32_t block_address) {
+    for (uint32_t i = 0; i < file->count; i++) {
+        if (file->entries[i].block_address == block_address) {
+            return &file->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static uint64_t earliest_ready(const MshrFile* file) {
+    uint64_t earliest = UINT64_MAX;
+    for (uint32_t i = 0; i < file->count; i++) {
+        if (file->entries[i].ready_cycle < earliest) earliest = file->entries[i].ready_cycle;
+    }
+    return earliest;
+}
+
+// Wait (advancing *now) until `file` has a free entry
+static void wait_for_mshr(MshrFile* file, uint64_t* now) {
+    if (file->count < file->capacity) return;
+    uint64_t ready = earliest_ready(file);
+    file->full_stalls++;
+    file->stall_cycles += ready - *now;
+    *now = ready;
+    retire_mshrs(file, ready);
+}
+
+// A demand access found the block in flight
+static void note_merge(MshrFile* file, MshrEntry* entry) {
+    if (entry->prefetch) {
+        file->late_prefetches++;
+        entry->prefetch = false;
+    } else {
+        file->merges++;
+    }
+}
+
+static void allocate_mshr(MshrFile* file, uint32_t block_address, uint64_t now, uint64_t ready,
+                          bool prefetch) {
+    MshrEntry* entry = &file->entries[file->count++];
+    entry->block_address = block_address;
+    entry->ready_cycle = ready;
+    entry->prefetch = prefetch;
+    if (prefetch) {
+        file->prefetches++;
+    } else {
+        file->allocations++;
+    }
+    file->busy_cycles += ready - now;
+    if (file->count > file->peak_occupancy) file->peak_occupancy = file->count;
+}
+
+// Claim the L2 bank of `block_address` for a lookup at `cycle`; returns the cycles spent waiting
+static uint64_t reserve_l2_bank(BankPorts* banks, uint32_t block_address, uint64_t cycle) {
+    if (banks->busy_cycles == 0) return 0;
+    uint32_t bank = (block_address >> BLOCK_OFFSET_BITS) & (banks->count - 1);
+    uint64_t start = banks->free_at[bank] > cycle ? banks->free_at[bank] : cycle;
+    if (start > cycle) {
+        banks->conflicts[bank]++;
+        banks->stall_cycles[bank] += start - cycle;
+    }
+    banks->free_at[bank] = start + banks->busy_cycles;
+    return start - cycle;
+}
+
+uint32_t miss_pipeline_issue(MissPipeline* pipeline, const LatencyConfig* latency,
+                             uint32_t block_address, ServiceLevel level) {
+    uint64_t issue = pipeline->now;
+    uint64_t now = issue;
+    uint64_t done;
+
+    retire_mshrs(pipeline->l1, now);
+    retire_mshrs(pipeline->l2, now);
+
+    MshrEntry* pending = level == SERVICE_WRITE_BUFFER ? NULL : find_mshr(pipeline->l1, block_address);
+    if (pending) {
+        // Secondary miss: the functional model already filled the block,
+        // but in time it is still on its way; it completes no sooner than
+        // the L1 lookup
+        note_merge(pipeline->l1, pending);
+        done = pending->ready_cycle;
+        uint64_t earliest = now + latency->l1;
+        if (done < earliest) done = earliest;
+    } else if (level == SERVICE_WRITE_BUFFER || level == SERVICE_L1 || level == SERVICE_VICTIM) {
+        done = now + service_latency(latency, level);
+    } else {
+        wait_for_mshr(pipeline->l1, &now);
+        retire_mshrs(pipeline->l2, now);
+        // The L2 lookup starts once L1 has missed
+        uint64_t bank_wait = reserve_l2_bank(&pipeline->banks, block_address, now + latency->l1);
+        MshrEntry* l2_pending = find_mshr(pipeline->l2, block_address);
+        if (l2_pending) {
+            // The block is still on its way into L2 (a demand or prefetch fill)
+            note_merge(pipeline->l2, l2_pending);
+            done = l2_pending->ready_cycle;
+            uint64_t earliest = now + bank_wait + service_latency(latency, SERVICE_L2);
+            if (done < earliest) done = earliest;
+        } else if (level == SERVICE_L2) {
+            done = now + bank_wait + service_latency(latency, SERVICE_L2);
+        } else {
+            wait_for_mshr(pipeline->l2, &now);
+            retire_mshrs(pipeline->l1, now);
+            done = now + bank_wait + service_latency(latency, SERVICE_MEMORY);
+            allocate_mshr(pipeline->l2, block_address, now, done, false);
+        }
+        allocate_mshr(pipeline->l1, block_address, now, done, false);
+    }
+
+    // The next operation issues one cycle after this one could
+    pipeline->now = now + 1;
+    if (done > pipeline->finish) pipeline->finish = done;
+    return (uint32_t)(done - issue);
+}
+
+bool miss_pipeline_prefetch(MissPipeline* pipeline, const LatencyConfig* latency,
+                            uint32_t block_address, bool into_l1, ServiceLevel source) {
+    uint64_t now = pipeline->now;
+    retire_mshrs(pipeline->l1, now);
+    retire_mshrs(pipeline->l2, now);
+
+    MshrFile* target = into_l1 ? pipeline->l1 : pipeline->l2;
+    if (find_mshr(target, block_address)) return true;
+
+    // A fill from memory into L1 passes through L2 and needs an entry at both
+    bool through_l2 = into_l1 && source == SERVICE_MEMORY && !find_mshr(pipeline->l2, block_address);
+    if (target->count == target->capacity ||
+        (through_l2 && pipeline->l2->count == pipeline->l2->capacity)) {
+        return false;
+    }
+
+    uint64_t lookup = into_l1 ? now + latency->l1 : now;
+    uint64_t done = now + reserve_l2_bank(&pipeline->banks, block_address, lookup) +
+                    service_latency(latency, source);
+    if (through_l2) allocate_mshr(pipeline->l2, block_address, now, done, true);
+    allocate_mshr(target, block_address, now, done, true);
+    return true;
+}
+
+uint64_t miss_pipeline_cycles(const MissPipeline* pipeline) {
+    return pipeline->finish > pipeline->now ? pipeline->finish : pipeline->now;
+}
+
+static void print_mshr_file(const char* name, const MshrFile* file, uint64_t cycles) {
+    printf("%s: %u entries, %llu primary misses, %llu merged, peak %u, average %.2f in use\n",
+           name, file->capacity, (unsigned long long)file->allocations,
+           (unsigned long long)file->merges, file->peak_occupancy,
+           cycles > 0 ? (double)file->busy_cycles / cycles : 0);
+    printf("%s: full %llu times, %llu stall cycles\n", name,
+           (unsigned long long)file->full_stalls, (unsigned long long)file->stall_cycles);
+    if (file->prefetches > 0) {
+        printf("%s: %llu prefetches, %llu late (a demand access merged)\n", name,
+               (unsigned long long)file->prefetches, (unsigned long long)file->late_prefetches);
+    }
+}
+
+void print_mshr_stats(const MissPipeline* pipeline) {
+    if (!miss_pipeline_enabled(pipeline)) return;
+    uint64_t cycles = miss_pipeline_cycles(pipeline);
+    printf("===== MSHR Statistics =====\n");
+    print_mshr_file("L1 MSHRs", pipeline->l1, cycles);
+    print_mshr_file("L2 MSHRs", pipeline->l2, cycles);
+    printf("===========================\n");
+}
@@ -0,0 +1,413 @@
+/**
+ * multicore.cpp
+ * Multi-core simulation: private L1s kept coherent with MESI, shared L2
+ */
+
+#include "multicore.h"
+#include "replacement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define MULTICORE_BLOCK_SIZE (1u << BLOCK_OFFSET_BITS)
+
+const char* interleave_policy_name(InterleavePolicy interleave) {
+    switch (interleave) {
+        case INTERLEAVE_ROUND_ROBIN: return "rr";
+        case INTERLEAVE_TIMESTAMP: return "time";
+    }
+    return "unknown";
+}
+
+bool parse_interleave_policy(const char* name, InterleavePolicy* interleave) {
+    if (strcasecmp(name, "rr") == 0 || strcasecmp(name, "round-robin") == 0) {
+        *interleave = INTERLEAVE_ROUND_ROBIN;
+    } else if (strcasecmp(name, "time") == 0 || strcasecmp(name, "timestamp") == 0) {
+        *interleave = INTERLEAVE_TIMESTAMP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+MultiCoreSystem* create_multicore_system(const ControllerConfig* config, uint32_t num_cores,
+                                         InterleavePolicy interleave) {
+    if (num_cores == 0 || num_cores > MULTICORE_MAX_CORES) {
+        fprintf(stderr, "Multi-core mode needs 1 to %d trace files\n", MULTICORE_MAX_CORES);
+        return NULL;
+    }
+
+    MultiCoreSystem* system = (MultiCoreSystem*)calloc(1, sizeof(MultiCoreSystem));
+    if (!system) return NULL;
+    system->cores = (Core*)calloc(num_cores, sizeof(Core));
+    system->num_cores = num_cores;
+    system->dataless = config->dataless;
+    system->interleave = interleave;
+    if (!system->cores) {
+        free_multicore_system(system);
+        return NULL;
+    }
+
+    // Core 0 and the L2 get the single-core seeds; the other L1s follow on
+    system->L2 = create_cache_level(&config->l2, config->dataless, config->seed + 1);
+    if (!system->L2) {
+        free_multicore_system(system);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < num_cores; i++) {
+        Core* core = &system->cores[i];
+        core->l1 = create_cache_level(&config->l1, config->dataless, i == 0 ? config->seed : config->seed + 1 + i);
+        if (!core->l1) {
+            free_multicore_system(system);
+            return NULL;
+        }
+        core->exclusive_mask = (uint64_t*)calloc(core->l1->num_sets, sizeof(uint64_t));
+        core->coherence_mask = (uint64_t*)calloc(core->l1->num_sets, sizeof(uint64_t));
+        if (!core->exclusive_mask || !core->coherence_mask) {
+            free_multicore_system(system);
+            return NULL;
+        }
+        init_timing_stats(&core->timing, &config->latency);
+    }
+    return system;
+}
+
+void free_multicore_system(MultiCoreSystem* system) {
+    if (!system) return;
+    if (system->cores) {
+        for (uint32_t i = 0; i < system->num_cores; i++) {
+            Core* core = &system->cores[i];
+            free_cache(core->l1);
+            free(core->exclusive_mask);
+            free(core->coherence_mask);
+            close_trace_reader(core->reader);
+            free(core->chunk);
+        }
+        free(system->cores);
+    }
+    free_cache(system->L2);
+    free(system);
+}
+
+static int32_t locate_block(const Cache* cache, uint32_t block_address, uint32_t* set_index) {
+    *set_index = get_index(block_address, cache->index_bits);
+    return cache_find_way(cache, *set_index, get_tag(block_address, cache->tag_bits, cache->index_bits));
+}
+
+// As in the single-core controller, a write-back is dropped if L2 no longer holds the block
+static void write_back_to_l2(MultiCoreSystem* system, uint32_t block_address, uint8_t* data) {
+    cache_write(system->L2, block_address, data);
+}
+
+static void make_room_in_l2(MultiCoreSystem* system, uint32_t set_index) {
+    Cache* l2 = system->L2;
+    if (!cache_set_full(l2, set_index)) return;
+    uint32_t way = get_victim_way(l2, set_index);
+    if (cache_line_dirty(l2, set_index, way)) {
+        system->memory_accesses++;
+        l2->write_backs++;
+    }
+    cache_invalidate_line(l2, set_index, way);
+}
+
+static void make_room_in_l1(MultiCoreSystem* system, Core* core, uint32_t set_index) {
+    Cache* l1 = core->l1;
+    if (!cache_set_full(l1, set_index)) return;
+    uint32_t way = get_victim_way(l1, set_index);
+    if (cache_line_dirty(l1, set_index, way)) {
+        uint32_t address = reconstruct_address(cache_line_tag(l1, set_index, way), set_index, 0, l1->index_bits);
+        write_back_to_l2(system, address, cache_line_data(l1, set_index, way));
+        l1->write_backs++;
+    }
+    cache_invalidate_line(l1, set_index, way);
+    core->exclusive_mask[set_index] &= ~(1ULL << way);
+}
+
+/**
+ * Broadcast a bus request from `requester`. An E or M owner supplies the
+ * block into `data`; with `invalidate` (BusRdX, upgrade) every other copy
+ * is dropped, otherwise copies fall back to S and an M owner flushes to
+ * L2. Returns the supplying core or -1; *shared tells whether a copy
+ * stays valid elsewhere.
+ */
+static int32_t snoop(MultiCoreSystem* system, uint32_t requester, uint32_t block_address,
+                     bool invalidate, uint8_t* data, bool* shared) {
+    int32_t supplier = -1;
+    *shared = false;
+
+    for (uint32_t i = 0; i < system->num_cores; i++) {
+        if (i == requester) continue;
+        Core* other = &system->cores[i];
+        uint32_t set_index;
+        int32_t found = locate_block(other->l1, block_address, &set_index);
+        if (found < 0) continue;
+
+        uint32_t way = (uint32_t)found;
+        uint64_t bit = 1ULL << way;
+        uint8_t* line = cache_line_data(other->l1, set_index, way);
+        if (other->exclusive_mask[set_index] & bit) {
+            if (data && line) memcpy(data, line, MULTICORE_BLOCK_SIZE);
+            other->interventions++;
+            supplier = (int32_t)i;
+            if (!invalidate && cache_line_dirty(other->l1, set_index, way)) {
+                write_back_to_l2(system, block_address, line);
+                cache_clean_line(other->l1, set_index, way);
+            }
+            other->exclusive_mask[set_index] &= ~bit;
+        }
+
+        if (invalidate) {
+            cache_invalidate_line(other->l1, set_index, way);
+            other->coherence_mask[set_index] |= bit;
+            other->invalidations++;
+        } else {
+            *shared = true;
+        }
+    }
+    return supplier;
+}
+
+// Whether a missing block's line was taken by another core's write and not reused since
+static bool take_coherence_loss(Core* core, uint32_t block_address) {
+    Cache* l1 = core->l1;
+    uint32_t set_index = get_index(block_address, l1->index_bits);
+    uint32_t tag = get_tag(block_address, l1->tag_bits, l1->index_bits);
+    uint64_t lost = core->coherence_mask[set_index];
+    while (lost) {
+        uint32_t way = (uint32_t)__builtin_ctzll(lost);
+        if (!cache_line_valid(l1, set_index, way) && cache_line_tag(l1, set_index, way) == tag) {
+            core->coherence_mask[set_index] &= ~(1ULL << way);
+            return true;
+        }
+        lost &= lost - 1;
+    }
+    return false;
+}
+
+/**
+ * Serve an L1 miss of `core`: BusRd or BusRdX, then the block comes from
+ * another core, L2 or memory (filling L2). The demand byte is transferred
+ * in L1. Returns the level that supplied the block.
+ */
+static ServiceLevel fill_l1(MultiCoreSystem* system, uint32_t c, uint32_t address, bool is_write,
+                            uint8_t* data) {
+    Core* core = &system->cores[c];
+    Cache* l1 = core->l1;
+    uint32_t block_address = address & ~(MULTICORE_BLOCK_SIZE - 1);
+    if (take_coherence_loss(core, block_address)) core->coherence_misses++;
+
+    uint8_t block_storage[MULTICORE_BLOCK_SIZE];
+    uint8_t* block_data = system->dataless ? NULL : block_storage;
+    bool shared;
+    if (is_write) {
+        system->bus_read_exclusives++;
+    } else {
+        system->bus_reads++;
+    }
+    ServiceLevel level = SERVICE_L2;  // A cache-to-cache transfer costs an L2 round trip
+    if (snoop(system, c, block_address, is_write, block_data, &shared) < 0) {
+        uint32_t l2_set;
+        int32_t l2_way = locate_block(system->L2, block_address, &l2_set);
+        if (cache_read(system->L2, address, NULL)) {
+            if (block_data) memcpy(block_data, cache_line_data(system->L2, l2_set, (uint32_t)l2_way), MULTICORE_BLOCK_SIZE);
+        } else {
+            system->memory_accesses++;
+            level = SERVICE_MEMORY;
+            if (block_data) memset(block_data, 0xAA, MULTICORE_BLOCK_SIZE);
+            make_room_in_l2(system, l2_set);
+            cache_insert(system->L2, block_address, block_data, false);
+        }
+    }
+
+    uint32_t set_index = get_index(block_address, l1->index_bits);
+    make_room_in_l1(system, core, set_index);
+    uint32_t way = cache_insert(l1, block_address, block_data, is_write);
+    uint64_t bit = 1ULL << way;
+    core->coherence_mask[set_index] &= ~bit;
+    if (is_write || !shared) {
+        core->exclusive_mask[set_index] |= bit;
+    } else {
+        core->exclusive_mask[set_index] &= ~bit;
+    }
+
+    uint8_t* line = cache_line_data(l1, set_index, way);
+    if (line && data) {
+        uint32_t offset = get_offset(address);
+        if (is_write) memcpy(&line[offset], data, 1);
+        else memcpy(data, &line[offset], 1);
+    }
+    return level;
+}
+
+// Blocking timing: each core advances its own clock by the access latency
+static void account_core_access(Core* core, bool is_write, ServiceLevel level) {
+    uint32_t latency = service_latency(&core->timing.latency, level);
+    core->timing.cycles += latency;
+    timing_record(&core->timing, is_write, level, latency);
+}
+
+bool multicore_read(MultiCoreSystem* system, uint32_t core, uint32_t address, uint8_t* data) {
+    if (system->dataless) data = NULL;
+    Core* c = &system->cores[core];
+    bool hit = cache_read(c->l1, address, data);
+    ServiceLevel level = hit ? SERVICE_L1 : fill_l1(system, core, address, false, data);
+    account_core_access(c, false, level);
+    return hit;
+}
+
+bool multicore_write(MultiCoreSystem* system, uint32_t core, uint32_t address, uint8_t* data) {
+    if (system->dataless) data = NULL;
+    Core* c = &system->cores[core];
+    uint32_t block_address = address & ~(MULTICORE_BLOCK_SIZE - 1);
+    uint32_t set_index;
+    int32_t way = locate_block(c->l1, block_address, &set_index);
+
+    ServiceLevel level = SERVICE_L1;
+    if (way >= 0 && !(c->exclusive_mask[set_index] & (1ULL << way))) {
+        // S -> M: the other copies must go before the write completes
+        bool shared;
+        snoop(system, core, block_address, true, NULL, &shared);
+        system->bus_upgrades++;
+        c->upgrades++;
+        c->exclusive_mask[set_index] |= 1ULL << way;
+        level = SERVICE_L2;
+    }
+
+    // E -> M is silent: the write marks the line dirty
+    bool hit = cache_write(c->l1, address, data);
+    if (!hit) level = fill_l1(system, core, address, true, data);
+    account_core_access(c, true, level);
+    return hit;
+}
+
+static void simulate_core_entry(MultiCoreSystem* system, uint32_t core, const TraceEntry* entry) {
+    uint8_t data[8];
+    switch (entry->op) {
+        case TRACE_INSTRUCTION:
+        case TRACE_LOAD:
+            multicore_read(system, core, entry->address, data);
+            break;
+        case TRACE_STORE:
+        case TRACE_MODIFY:
+            multicore_write(system, core, entry->address, (uint8_t*)entry->data);
+            break;
+    }
+}
+
+// Next core to issue, or -1 once every trace is exhausted
+static int32_t pick_core(const MultiCoreSystem* system, uint32_t* next_turn) {
+    int32_t chosen = -1;
+    for (uint32_t k = 0; k < system->num_cores; k++) {
+        uint32_t i = (*next_turn + k) % system->num_cores;
+        const Core* core = &system->cores[i];
+        if (core->finished) continue;
+        if (system->interleave == INTERLEAVE_ROUND_ROBIN) {
+            chosen = (int32_t)i;
+            break;
+        }
+        if (chosen < 0 || core->timing.cycles < system->cores[chosen].timing.cycles) chosen = (int32_t)i;
+    }
+    if (chosen >= 0 && system->interleave == INTERLEAVE_ROUND_ROBIN) {
+        *next_turn = ((uint32_t)chosen + 1) % system->num_cores;
+    }
+    return chosen;
+}
+
+int process_multicore_traces(MultiCoreSystem* system, const char* const* filenames, TraceRun* run) {
+    for (uint32_t i = 0; i < system->num_cores; i++) {
+        Core* core = &system->cores[i];
+        core->trace_name = filenames[i];
+        core->reader = open_trace_reader(filenames[i]);
+        core->chunk = (TraceEntry*)malloc(sizeof(TraceEntry) * TRACE_CHUNK_ENTRIES);
+        if (!core->reader || !core->chunk) {
+            fprintf(stderr, "Failed to open trace for core %u: %s\n", i, filenames[i]);
+            return -1;
+        }
+    }
+
+    printf("Interleaving %u traces (%s)\n", system->num_cores,
+           system->interleave == INTERLEAVE_ROUND_ROBIN ? "round-robin" : "by core clock");
+
+    uint32_t next_turn = 0;
+    uint64_t report_at = trace_run_next_report(run);
+    int32_t c;
+    while ((c = pick_core(system, &next_turn)) >= 0) {
+        Core* core = &system->cores[c];
+        if (core->chunk_pos == core->chunk_length) {
+            core->chunk_length = trace_reader_next_chunk(core->reader, core->chunk, TRACE_CHUNK_ENTRIES);
+            core->chunk_pos = 0;
+            if (core->chunk_length == 0) {
+                core->finished = true;
+                continue;
+            }
+        }
+        simulate_core_entry(system, (uint32_t)c, &core->chunk[core->chunk_pos++]);
+        core->records++;
+        if (run && ++run->records == report_at) report_at = trace_run_report(run);
+    }
+
+    for (uint32_t i = 0; i < system->num_cores; i++) {
+        printf("Core %u: %llu entries from %s\n", i, (unsigned long long)system->cores[i].records,
+               system->cores[i].trace_name);
+    }
+    return 0;
+}
+
+void print_multicore_stats(const MultiCoreSystem* system) {
+    TimingStats total;
+    init_timing_stats(&total, &system->cores[0].timing.latency);
+    uint64_t elapsed = 0;
+
+    for (uint32_t i = 0; i < system->num_cores; i++) {
+        const Core* core = &system->cores[i];
+        char name[32];
+        snprintf(name, sizeof(name), "Core %u L1 Cache", i);
+        print_cache_stats(core->l1, name);
+        printf("Core %u coherence: %llu invalidations, %llu interventions, %llu upgrades\n", i,
+               (unsigned long long)core->invalidations, (unsigned long long)core->interventions,
+               (unsigned long long)core->upgrades);
+        printf("Core %u coherence misses: %llu (%.2f%% of L1 misses)\n", i,
+               (unsigned long long)core->coherence_misses,
+               core->l1->misses > 0 ? (double)core->coherence_misses / core->l1->misses * 100 : 0);
+        printf("Core %u: %llu cycles, AMAT %.2f cycles\n", i, (unsigned long long)core->timing.cycles,
+               timing_amat(&core->timing));
+
+        merge_timing_stats(&total, &core->timing);
+        if (core->timing.cycles > elapsed) elapsed = core->timing.cycles;
+    }
+
+    print_cache_stats(system->L2, "Shared L2 Cache");
+    print_l2_bank_stats(system->L2, NULL);
+    printf("Memory accesses: %llu\n", (unsigned long long)system->memory_accesses);
+    printf("===== Coherence Bus =====\n");
+    printf("BusRd: %llu, BusRdX: %llu, upgrades: %llu\n", (unsigned long long)system->bus_reads,
+           (unsigned long long)system->bus_read_exclusives, (unsigned long long)system->bus_upgrades);
+    printf("=========================\n");
+
+    // Cores run side by side: elapsed time is the slowest core's clock
+    total.cycles = elapsed;
+    print_timing_stats(&total, false);
+}
+
+bool register_multicore_stats(StatsRegistry* registry, MultiCoreSystem* system) {
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < system->num_cores; i++) {
+        Core* core = &system->cores[i];
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "core%u.l1", i);
+        ok = stats_register_cache(registry, prefix, core->l1);
+        snprintf(prefix, sizeof(prefix), "core%u", i);
+        ok = ok && stats_register(registry, prefix, "records", &core->records) &&
+             stats_register(registry, prefix, "cycles", &core->timing.cycles) &&
+             stats_register(registry, prefix, "invalidations", &core->invalidations) &&
+             stats_register(registry, prefix, "interventions", &core->interventions) &&
+             stats_register(registry, prefix, "upgrades", &core->upgrades) &&
+             stats_register(registry, prefix, "coherence_misses", &core->coherence_misses);
+    }
+    return ok && stats_register_cache(registry, "l2", system->L2) &&
+           stats_register(registry, "", "memory_accesses", &system->memory_accesses) &&
+           stats_register(registry, "bus", "reads", &system->bus_reads) &&
+           stats_register(registry, "bus", "read_exclusives", &system->bus_read_exclusives) &&
+           stats_register(registry, "bus", "upgrades", &system->bus_upgrades);
+}
@@ -0,0 +1,228 @@
+/**
+ * parallel.cpp
+ * Set-sharded parallel simulation of a single configuration
+ *
+ * The main thread streams the trace and partitions every chunk by shard
+ * into per-shard batches; each shard thread owns a private controller and
+ * replays its batches in order. Batches travel through a small bounded
+ * ring per shard, so memory stays constant for any trace length.
+ */
+
+#include "parallel.h"
+#include "trace_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    CacheController* controller;
+    pthread_t thread;
+
+    // Ring of batches: the producer fills slot (head + filled) and the
+    // shard drains slot head; both sides touch `filled` under the lock
+    TraceEntry* batches[SHARD_QUEUE_DEPTH];
+    size_t lengths[SHARD_QUEUE_DEPTH];
+    uint32_t head;
+    uint32_t filled;
+    bool finished;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+
+    // Producer-side slot currently being filled (NULL when none)
+    TraceEntry* current;
+    size_t current_length;
+} Shard;
+
+uint32_t max_trace_shards(const ControllerConfig* config) {
+    uint32_t bits = config->l1.index_bits < config->l2.index_bits ? config->l1.index_bits
+                                                                  : config->l2.index_bits;
+    return 1u << bits;
+}
+
+static void* shard_worker(void* arg) {
+    Shard* shard = (Shard*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&shard->lock);
+        while (shard->filled == 0 && !shard->finished) {
+            pthread_cond_wait(&shard->not_empty, &shard->lock);
+        }
+        if (shard->filled == 0) {
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        }
+        uint32_t slot = shard->head;
+        pthread_mutex_unlock(&shard->lock);
+
+        const TraceEntry* batch = shard->batches[slot];
+        size_t length = shard->lengths[slot];
+        for (size_t i = 0; i < length; i++) {
+            simulate_trace_entry(shard->controller, &batch[i]);
+        }
+
+        pthread_mutex_lock(&shard->lock);
+        shard->head = (shard->head + 1) % SHARD_QUEUE_DEPTH;
+        shard->filled--;
+        pthread_cond_signal(&shard->not_full);
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return NULL;
+}
+
+// Wait for a free slot and start filling it
+static void acquire_slot(Shard* shard) {
+    pthread_mutex_lock(&shard->lock);
+    while (shard->filled == SHARD_QUEUE_DEPTH) {
+        pthread_cond_wait(&shard->not_full, &shard->lock);
+    }
+    shard->current = shard->batches[(shard->head + shard->filled) % SHARD_QUEUE_DEPTH];
+    pthread_mutex_unlock(&shard->lock);
+    shard->current_length = 0;
+}
+
+static void publish_slot(Shard* shard) {
+    pthread_mutex_lock(&shard->lock);
+    shard->lengths[(shard->head + shard->filled) % SHARD_QUEUE_DEPTH] = shard->current_length;
+    shard->filled++;
+    pthread_cond_signal(&shard->not_empty);
+    pthread_mutex_unlock(&shard->lock);
+    shard->current = NULL;
+}
+
+static void dispatch_entry(Shard* shard, const TraceEntry* entry) {
+    if (!shard->current) acquire_slot(shard);
+    shard->current[shard->current_length++] = *entry;
+    if (shard->current_length == SHARD_BATCH_ENTRIES) publish_slot(shard);
+}
+
+static void add_cache_stats(Cache* total, const Cache* part) {
+    total->accesses += part->accesses;
+    total->hits += part->hits;
+    total->misses += part->misses;
+    total->write_backs += part->write_backs;
+    if (total->bank_accesses && part->bank_accesses) {
+        for (uint32_t b = 0; b < total->num_banks; b++) {
+            total->bank_accesses[b] += part->bank_accesses[b];
+        }
+    }
+    // A shard only touches its own sets, so the sums are that shard's counters
+    if (total->set_stats && part->set_stats) {
+        for (uint32_t s = 0; s < total->num_sets; s++) {
+            total->set_stats[s].accesses += part->set_stats[s].accesses;
+            total->set_stats[s].misses += part->set_stats[s].misses;
+            total->set_stats[s].evictions += part->set_stats[s].evictions;
+        }
+    }
+}
+
+static void add_inclusion_stats(InclusionStats* total, const InclusionStats* part) {
+    total->back_invalidations += part->back_invalidations;
+    total->dirty_back_invalidations += part->dirty_back_invalidations;
+    total->promotions += part->promotions;
+    total->swaps += part->swaps;
+    total->demotions += part->demotions;
+}
+
+static void destroy_shards(Shard* shards, uint32_t count) {
+    for (uint32_t s = 0; s < count; s++) {
+        for (uint32_t b = 0; b < SHARD_QUEUE_DEPTH; b++) {
+            free(shards[s].batches[b]);
+        }
+        free_cache_controller(shards[s].controller);
+        pthread_mutex_destroy(&shards[s].lock);
+        pthread_cond_destroy(&shards[s].not_empty);
+        pthread_cond_destroy(&shards[s].not_full);
+    }
+    free(shards);
+}
+
+int process_usimm_trace_sharded(CacheController* merged, const ControllerConfig* config,
+                                const char* const* filenames, int num_files, uint32_t shards) {
+    if (shards == 0 || (shards & (shards - 1)) != 0 || shards > max_trace_shards(config)) {
+        fprintf(stderr, "Shard count must be a power of two no larger than %u\n",
+                max_trace_shards(config));
+        return -1;
+    }
+
+    Shard* shard_list = (Shard*)calloc(shards, sizeof(Shard));
+    if (!shard_list) return -1;
+
+    uint32_t created = 0;
+    for (; created < shards; created++) {
+        Shard* shard = &shard_list[created];
+        pthread_mutex_init(&shard->lock, NULL);
+        pthread_cond_init(&shard->not_empty, NULL);
+        pthread_cond_init(&shard->not_full, NULL);
+        shard->controller = create_cache_controller(config);
+        bool ok = shard->controller != NULL;
+        for (uint32_t b = 0; b < SHARD_QUEUE_DEPTH && ok; b++) {
+            shard->batches[b] = (TraceEntry*)malloc(sizeof(TraceEntry) * SHARD_BATCH_ENTRIES);
+            ok = shard->batches[b] != NULL;
+        }
+        if (!ok) {
+            fprintf(stderr, "Failed to create shard %u\n", created);
+            destroy_shards(shard_list, created + 1);
+            return -1;
+        }
+    }
+
+    uint32_t started = 0;
+    for (; started < shards; started++) {
+        if (pthread_create(&shard_list[started].thread, NULL, shard_worker, &shard_list[started]) != 0) {
+            fprintf(stderr, "Failed to start shard thread %u\n", started);
+            break;
+        }
+    }
+
+    int status = started == shards ? 0 : -1;
+    uint32_t mask = shards - 1;
+    TraceEntry chunk[TRACE_CHUNK_ENTRIES];
+    uint64_t processed = 0;
+
+    for (int f = 0; f < num_files && status == 0; f++) {
+        TraceReader* reader = open_trace_reader(filenames[f]);
+        if (!reader) {
+            status = -1;
+            break;
+        }
+        printf("\nProcessing trace file: %s (%u shards)\n", filenames[f], shards);
+
+        size_t got;
+        while ((got = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_ENTRIES)) > 0) {
+            for (size_t i = 0; i < got; i++) {
+                uint32_t shard = (chunk[i].address >> BLOCK_OFFSET_BITS) & mask;
+                dispatch_entry(&shard_list[shard], &chunk[i]);
+            }
+            processed += got;
+        }
+        close_trace_reader(reader);
+    }
+
+    // Flush partial batches and let the started shards drain
+    for (uint32_t s = 0; s < shards; s++) {
+        Shard* shard = &shard_list[s];
+        if (shard->current && s < started) publish_slot(shard);
+        pthread_mutex_lock(&shard->lock);
+        shard->finished = true;
+        pthread_cond_signal(&shard->not_empty);
+        pthread_mutex_unlock(&shard->lock);
+    }
+    for (uint32_t s = 0; s < started; s++) {
+        pthread_join(shard_list[s].thread, NULL);
+    }
+
+    for (uint32_t s = 0; s < shards; s++) {
+        CacheController* part = shard_list[s].controller;
+        add_cache_stats(merged->L1, part->L1);
+        add_cache_stats(merged->L2, part->L2);
+        merged->memory_accesses += part->memory_accesses;
+        add_inclusion_stats(&merged->inclusion_stats, &part->inclusion_stats);
+        merge_timing_stats(&merged->timing, &part->timing);
+    }
+
+    printf("Processed %llu entries in total\n", (unsigned long long)processed);
+    destroy_shards(shard_list, shards);
+    return status;
+}
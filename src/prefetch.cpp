@@ -0,0 +1,197 @@
+/**
+ * prefetch.cpp
+ * Hardware prefetchers (next-line, stride, stream)
+ */
+
+#include "prefetch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+// Highest block number; candidates past either end of the address space are skipped
+#define MAX_BLOCK ((1u << (ADDR_BITS - BLOCK_OFFSET_BITS)) - 1)
+
+static void queue_candidate(Prefetcher* pf, int64_t block) {
+    if (block < 0 || block > MAX_BLOCK || pf->num_pending == PREFETCH_MAX_DEGREE) return;
+    pf->pending[pf->num_pending++] = (uint32_t)block;
+    pf->issued++;
+}
+
+static void queue_run(Prefetcher* pf, uint32_t block, int32_t step) {
+    for (uint32_t k = 1; k <= pf->degree; k++) {
+        queue_candidate(pf, (int64_t)block + (int64_t)step * k);
+    }
+}
+
+// Next-line
+static void observe_next_line(Prefetcher* pf, uint32_t block, bool miss, bool prefetch_hit) {
+    if (miss || prefetch_hit) queue_run(pf, block, 1);
+}
+
+// Stride
+typedef struct {
+    uint32_t region;
+    uint32_t last_block;
+    int32_t stride;
+    uint8_t confidence;   // 0..3; prefetch from 2
+    bool valid;
+} StrideEntry;
+
+static void observe_stride(Prefetcher* pf, uint32_t block, bool miss, bool prefetch_hit) {
+    (void)miss;
+    (void)prefetch_hit;
+    StrideEntry* table = (StrideEntry*)pf->state;
+    uint32_t region = block >> (12 - BLOCK_OFFSET_BITS);
+    StrideEntry* e = &table[region % STRIDE_TABLE_ENTRIES];
+
+    if (!e->valid || e->region != region) {
+        e->valid = true;
+        e->region = region;
+        e->last_block = block;
+        e->stride = 0;
+        e->confidence = 0;
+        return;
+    }
+
+    int32_t delta = (int32_t)(block - e->last_block);
+    if (delta == 0) return;
+    if (delta == e->stride) {
+        if (e->confidence < 3) e->confidence++;
+    } else if (e->confidence > 0) {
+        e->confidence--;
+    } else {
+        e->stride = delta;
+    }
+    e->last_block = block;
+
+    if (e->confidence >= 2) queue_run(pf, block, e->stride);
+}
+
+// Stream
+typedef struct {
+    uint32_t head;        // Most recent block of the stream
+    int32_t direction;    // +1, -1, or 0 while training
+    uint64_t last_use;
+    bool valid;
+} StreamTracker;
+
+typedef struct {
+    StreamTracker trackers[STREAM_TRACKERS];
+    uint64_t clock;
+} StreamState;
+
+static void observe_stream(Prefetcher* pf, uint32_t block, bool miss, bool prefetch_hit) {
+    if (!miss && !prefetch_hit) return;
+    StreamState* st = (StreamState*)pf->state;
+    st->clock++;
+
+    // Replace a free tracker if there is one, else the least recently used
+    StreamTracker* victim = NULL;
+    for (uint32_t i = 0; i < STREAM_TRACKERS; i++) {
+        StreamTracker* t = &st->trackers[i];
+        if (!t->valid) {
+            if (!victim || victim->valid) victim = t;
+            continue;
+        }
+        if (!victim || (victim->valid && t->last_use < victim->last_use)) victim = t;
+
+        int64_t delta = (int64_t)block - t->head;
+        if (delta == 0 || delta > STREAM_WINDOW || delta < -STREAM_WINDOW) continue;
+
+        int32_t direction = delta > 0 ? 1 : -1;
+        bool confirmed = t->direction == direction;
+        t->direction = direction;
+        t->head = block;
+        t->last_use = st->clock;
+        // Two accesses in the same direction confirm the stream
+        if (confirmed) queue_run(pf, block, direction);
+        return;
+    }
+
+    victim->valid = true;
+    victim->head = block;
+    victim->direction = 0;
+    victim->last_use = st->clock;
+}
+
+Prefetcher* create_prefetcher(PrefetcherKind kind, uint32_t degree) {
+    if (kind == PREFETCH_NONE || degree == 0 || degree > PREFETCH_MAX_DEGREE) return NULL;
+
+    Prefetcher* pf = (Prefetcher*)calloc(1, sizeof(Prefetcher));
+    if (!pf) return NULL;
+    pf->kind = kind;
+    pf->degree = degree;
+
+    switch (kind) {
+        case PREFETCH_NEXT_LINE:
+            pf->observe = observe_next_line;
+            break;
+        case PREFETCH_STRIDE:
+            pf->observe = observe_stride;
+            pf->state = calloc(STRIDE_TABLE_ENTRIES, sizeof(StrideEntry));
+            break;
+        case PREFETCH_STREAM:
+            pf->observe = observe_stream;
+            pf->state = calloc(1, sizeof(StreamState));
+            break;
+        case PREFETCH_NONE:
+            break;
+    }
+
+    if (kind != PREFETCH_NEXT_LINE && !pf->state) {
+        free(pf);
+        return NULL;
+    }
+    return pf;
+}
+
+void free_prefetcher(Prefetcher* pf) {
+    if (pf) {
+        free(pf->state);
+        free(pf);
+    }
+}
+
+const char* prefetcher_name(PrefetcherKind kind) {
+    switch (kind) {
+        case PREFETCH_NONE: return "none";
+        case PREFETCH_NEXT_LINE: return "next-line";
+        case PREFETCH_STRIDE: return "stride";
+        case PREFETCH_STREAM: return "stream";
+    }
+    return "unknown";
+}
+
+bool parse_prefetcher(const char* name, PrefetcherKind* kind) {
+    static const PrefetcherKind all[] = { PREFETCH_NONE, PREFETCH_NEXT_LINE, PREFETCH_STRIDE, PREFETCH_STREAM };
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        if (strcasecmp(name, prefetcher_name(all[i])) == 0) {
+            *kind = all[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole > 0 ? (double)part / whole * 100 : 0;
+}
+
+void print_prefetch_stats(const char* name, const Prefetcher* pf, uint64_t useful, uint64_t unused,
+                          uint64_t demand_misses, bool have_timing, uint64_t late) {
+    printf("===== %s Prefetcher (%s, degree %u) =====\n", name, prefetcher_name(pf->kind), pf->degree);
+    printf("Candidates: %llu (already cached %llu, dropped %llu)\n",
+           (unsigned long long)pf->issued, (unsigned long long)pf->redundant,
+           (unsigned long long)pf->dropped);
+    printf("Fills: %llu (from memory %llu)\n",
+           (unsigned long long)pf->fills, (unsigned long long)pf->memory_fetches);
+    printf("Useful: %llu, accuracy %.2f%%, coverage %.2f%%\n", (unsigned long long)useful,
+           percent(useful, pf->fills), percent(useful, useful + demand_misses));
+    if (have_timing) {
+        printf("Late (demand arrived before the fill): %llu, timely %.2f%%\n",
+               (unsigned long long)late, percent(useful > late ? useful - late : 0, useful));
+    }
+    printf("Evicted unused: %llu, demand lines displaced: %llu\n",
+           (unsigned long long)unused, (unsigned long long)pf->displaced);
+    printf("==========================================\n");
+}
@@ -0,0 +1,84 @@
+/**
+ * profile.cpp
+ * Optional self-profiling of the simulator's hot paths
+ */
+
+#include "profile.h"
+
+#ifdef CACHE_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROFILE_UNIT "TSC cycles"
+#else
+#define PROFILE_UNIT "ns"
+#endif
+
+__thread ProfileCounters profile_counters;
+
+static const char* const point_names[PROFILE_POINTS] = {
+    "cache_read",
+    "cache_write",
+    "cache_insert",
+    "get_victim_way",
+    "handle_eviction.l1",
+    "handle_eviction.l2",
+    "check_write_buffer",
+    "insert_write_buffer",
+    "write_buffer_pop",
+    "trace_reader_next_chunk",
+};
+
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+static ProfileCounters totals;
+static uint32_t threads;
+static pthread_key_t thread_key;
+static pthread_once_t setup_once = PTHREAD_ONCE_INIT;
+
+static void fold_counters(ProfileCounters* counters) {
+    pthread_mutex_lock(&totals_lock);
+    for (int p = 0; p < PROFILE_POINTS; p++) {
+        totals.calls[p] += counters->calls[p];
+        totals.cycles[p] += counters->cycles[p];
+        counters->calls[p] = 0;
+        counters->cycles[p] = 0;
+    }
+    threads++;
+    pthread_mutex_unlock(&totals_lock);
+}
+
+// Key destructor: runs as a worker thread exits, with its counters still live
+static void fold_exiting_thread(void* counters) {
+    fold_counters((ProfileCounters*)counters);
+}
+
+static void print_profile(void) {
+    // The main thread never runs key destructors, so fold it here
+    if (profile_counters.registered) fold_counters(&profile_counters);
+
+    fprintf(stderr, "\n===== Self-Profile (%s, inclusive, %u threads) =====\n", PROFILE_UNIT, threads);
+    fprintf(stderr, "%-24s %14s %18s %12s\n", "Function", "Calls", "Total", "Per call");
+    for (int p = 0; p < PROFILE_POINTS; p++) {
+        if (totals.calls[p] == 0) continue;
+        fprintf(stderr, "%-24s %14llu %18llu %12.1f\n", point_names[p],
+                (unsigned long long)totals.calls[p], (unsigned long long)totals.cycles[p],
+                (double)totals.cycles[p] / totals.calls[p]);
+    }
+    fprintf(stderr, "====================================================\n");
+}
+
+static void setup_profile(void) {
+    pthread_key_create(&thread_key, fold_exiting_thread);
+    atexit(print_profile);
+}
+
+void profile_register_thread(void) {
+    pthread_once(&setup_once, setup_profile);
+    pthread_setspecific(thread_key, &profile_counters);
+    profile_counters.registered = true;
+}
+
+#endif // CACHE_PROFILE
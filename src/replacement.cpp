@@ -4,34 +4,178 @@
  */
 
  #include "replacement.h"
+ #include "profile.h"
  #include <stdlib.h>
- #include <time.h>
+ #include <strings.h>
  
- uint32_t get_victim_way(Cache* cache, uint32_t set_index) {
-     uint32_t victim_way = 0;
+ bool init_replacement_state(Cache* cache) {
+     uint32_t ways = cache->associativity;
      
      switch (cache->policy) {
-         case LRU: {
-             uint64_t min_access_time = UINT64_MAX;
-             for (uint32_t i = 0; i < cache->associativity; i++) {
-                 if (!cache->sets[set_index][i].valid) {
-                     return i;
-                 }
-                 if (cache->sets[set_index][i].last_access_time < min_access_time) {
-                     min_access_time = cache->sets[set_index][i].last_access_time;
-                     victim_way = i;
+         case LRU:
+             cache->age_rank = (uint8_t*)malloc((size_t)cache->num_sets * ways);
+             if (!cache->age_rank) return false;
+             for (uint32_t set = 0; set < cache->num_sets; set++) {
+                 for (uint32_t i = 0; i < ways; i++) {
+                     cache->age_rank[(size_t)set * ways + i] = (uint8_t)i;
                  }
              }
+             return true;
+         case FIFO:
+         case PLRU:
+             cache->repl_words = 1;
+             break;
+         case SRRIP:
+         case BRRIP:
+         case DRRIP:
+             cache->repl_words = 2;
+             cache->psel = 1u << (DRRIP_PSEL_BITS - 1);
              break;
+         case RANDOM:
+             return true;
+     }
+     
+     cache->repl_state = (uint64_t*)calloc((size_t)cache->num_sets * cache->repl_words, sizeof(uint64_t));
+     return cache->repl_state != NULL;
+ }
+ 
+ // Ways whose RRPV is RRPV_MAX; ages the whole set until there is one
+ static uint32_t rrip_victim(Cache* cache, uint32_t set_index) {
+     uint64_t* planes = &cache->repl_state[(size_t)set_index * 2];
+     uint64_t lo = planes[0], hi = planes[1];
+     uint64_t distant;
+     
+     while (!(distant = lo & hi & cache->full_mask)) {
+         // No way is at RRPV_MAX, so incrementing every RRPV cannot overflow
+         uint64_t next_lo = ~lo & cache->full_mask;
+         hi |= lo;
+         lo = next_lo;
+     }
+     
+     planes[0] = lo;
+     planes[1] = hi;
+     return (uint32_t)__builtin_ctzll(distant);
+ }
+ 
+ uint32_t get_victim_way(Cache* cache, uint32_t set_index) {
+     PROFILE_SCOPE(PROFILE_GET_VICTIM_WAY);
+     uint64_t free_ways = ~cache->valid_mask[set_index] & cache->full_mask;
+     if (free_ways) {
+         return (uint32_t)__builtin_ctzll(free_ways);
+     }
+     if (cache->set_stats) cache->set_stats[set_index].evictions++;
+     
+     switch (cache->policy) {
+         case LRU: {
+             const uint8_t* ranks = &cache->age_rank[(size_t)set_index * cache->associativity];
+             const uint8_t* oldest = (const uint8_t*)memchr(ranks, (int)cache->associativity - 1,
+                                                           cache->associativity);
+             return (uint32_t)(oldest - ranks);
          }
          case RANDOM:
-             victim_way = rand() % cache->associativity;
+             return cache_random_below(cache, cache->associativity);
+         case FIFO:
+             return (uint32_t)cache->repl_state[set_index];
+         case PLRU: {
+             uint64_t tree = cache->repl_state[set_index];
+             uint32_t node = 1;
+             while (node < cache->associativity) {
+                 node = 2 * node + (uint32_t)((tree >> node) & 1);
+             }
+             return node - cache->associativity;
+         }
+         case SRRIP:
+         case BRRIP:
+         case DRRIP:
+             return rrip_victim(cache, set_index);
+     }
+     
+     return 0;
+ }
+ 
+ /**
+  * DRRIP set dueling: one set in every `stride` always uses SRRIP and
+  * another always uses BRRIP. There are min(32, sets / 4) leaders of
+  * each, so at least half the sets follow. Misses in the leader sets
+  * move PSEL, which picks the policy for the followers. Below
+  * DRRIP_MIN_SETS there is no room to duel and every set uses SRRIP.
+  */
+ static ReplacementPolicy drrip_fill_policy(Cache* cache, uint32_t set_index) {
+     if (cache->num_sets < DRRIP_MIN_SETS) return SRRIP;
+     uint32_t leaders = cache->num_sets / 4;
+     if (leaders > DRRIP_MAX_LEADERS) leaders = DRRIP_MAX_LEADERS;
+     uint32_t stride = cache->num_sets / leaders;
+     uint32_t slot = set_index & (stride - 1);
+     uint32_t psel_max = (1u << DRRIP_PSEL_BITS) - 1;
+     
+     if (slot == 0) {
+         if (cache->psel < psel_max) cache->psel++;
+         return SRRIP;
+     }
+     if (slot == stride / 2) {
+         if (cache->psel > 0) cache->psel--;
+         return BRRIP;
+     }
+     return cache->psel > psel_max / 2 ? BRRIP : SRRIP;
+ }
+ 
+ void replacement_on_fill(Cache* cache, uint32_t set_index, uint32_t way) {
+     ReplacementPolicy policy = cache->policy;
+     if (policy == DRRIP) {
+         policy = drrip_fill_policy(cache, set_index);
+     }
+     
+     switch (policy) {
+         case LRU:
+         case PLRU:
+             replacement_on_hit(cache, set_index, way);
              break;
          case FIFO:
-             // Using LRU as fallback for FIFO
-             victim_way = get_victim_way(cache, set_index);
+             // The pointer follows insertion order; a refill of an
+             // invalidated way elsewhere in the set leaves it in place
+             if (cache->repl_state[set_index] == way) {
+                 cache->repl_state[set_index] = (way + 1) % cache->associativity;
+             }
+             break;
+         case SRRIP:
+         case BRRIP: {
+             // SRRIP inserts at RRPV_MAX - 1 ("long"); BRRIP mostly at
+             // RRPV_MAX ("distant") so scans do not flush the set
+             uint64_t* planes = &cache->repl_state[(size_t)set_index * 2];
+             uint64_t bit = 1ULL << way;
+             bool distant = policy == BRRIP &&
+                            cache_random_below(cache, BRRIP_LONG_INTERVAL) != 0;
+             planes[1] |= bit;
+             if (distant) planes[0] |= bit;
+             else planes[0] &= ~bit;
+             break;
+         }
+         case RANDOM:
+         case DRRIP:
              break;
      }
-     
-     return victim_way;
- }
\ No newline at end of file
+ }
+ 
+ const char* replacement_policy_name(ReplacementPolicy policy) {
+     switch (policy) {
+         case LRU: return "lru";
+         case RANDOM: return "random";
+         case FIFO: return "fifo";
+         case PLRU: return "plru";
+         case SRRIP: return "srrip";
+         case BRRIP: return "brrip";
+         case DRRIP: return "drrip";
+     }
+     return "unknown";
+ }
+ 
+ bool parse_replacement_policy(const char* name, ReplacementPolicy* policy) {
+     static const ReplacementPolicy all[] = { LRU, RANDOM, FIFO, PLRU, SRRIP, BRRIP, DRRIP };
+     for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+         if (strcasecmp(name, replacement_policy_name(all[i])) == 0) {
+             *policy = all[i];
+             return true;
+         }
+     }
+     return false;
+ }
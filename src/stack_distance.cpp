@@ -0,0 +1,239 @@
+/**
+ * stack_distance.cpp
+ * Single-pass LRU stack-distance (Mattson) analysis
+ */
+
+#include "stack_distance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SD_INITIAL_SET_CAPACITY 16
+#define SD_INITIAL_MAP_CAPACITY 1024
+
+// Fenwick tree over [0, capacity): add `delta` at position i
+static inline void fenwick_add(int32_t* tree, uint32_t capacity, uint32_t i, int32_t delta) {
+    for (i++; i <= capacity; i += i & (0u - i)) {
+        tree[i - 1] += delta;
+    }
+}
+
+// Sum of positions [0, i)
+static inline int32_t fenwick_prefix(const int32_t* tree, uint32_t i) {
+    int32_t sum = 0;
+    for (; i > 0; i -= i & (0u - i)) {
+        sum += tree[i - 1];
+    }
+    return sum;
+}
+
+static inline uint32_t hash_block(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x7FEB352Du;
+    key ^= key >> 15;
+    key *= 0x846CA68Bu;
+    key ^= key >> 16;
+    return key;
+}
+
+// Returns the slot holding `key`, or the empty slot where it belongs
+static inline uint32_t map_slot(const SDConfig* config, uint32_t key) {
+    uint32_t mask = config->map_capacity - 1;
+    uint32_t slot = hash_block(key) & mask;
+    while (config->keys[slot] != 0 && config->keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static bool grow_map(SDConfig* config) {
+    uint32_t old_capacity = config->map_capacity;
+    uint32_t* old_keys = config->keys;
+    uint32_t* old_times = config->times;
+
+    config->map_capacity = old_capacity ? old_capacity * 2 : SD_INITIAL_MAP_CAPACITY;
+    config->keys = (uint32_t*)calloc(config->map_capacity, sizeof(uint32_t));
+    config->times = (uint32_t*)malloc(config->map_capacity * sizeof(uint32_t));
+    if (!config->keys || !config->times) {
+        free(config->keys);
+        free(config->times);
+        config->keys = old_keys;
+        config->times = old_times;
+        config->map_capacity = old_capacity;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] != 0) {
+            uint32_t slot = map_slot(config, old_keys[i]);
+            config->keys[slot] = old_keys[i];
+            config->times[slot] = old_times[i];
+        }
+    }
+    free(old_keys);
+    free(old_times);
+    return true;
+}
+
+/**
+ * Renumber the resident blocks of a set 0..live-1 in recency order and
+ * rebuild its Fenwick tree, growing it so at least half is free again.
+ */
+static bool compact_set(SDConfig* config, SDSet* set) {
+    uint32_t capacity = set->capacity ? set->capacity : SD_INITIAL_SET_CAPACITY;
+    while (capacity < 2 * set->live + SD_INITIAL_SET_CAPACITY) {
+        capacity *= 2;
+    }
+
+    uint32_t* owner = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    int32_t* fenwick = (int32_t*)calloc(capacity, sizeof(int32_t));
+    if (!owner || !fenwick) {
+        free(owner);
+        free(fenwick);
+        return false;
+    }
+
+    uint32_t next = 0;
+    for (uint32_t t = 0; t < set->clock; t++) {
+        uint32_t key = set->owner[t];
+        if (key == 0) continue;
+        owner[next] = key;
+        config->times[map_slot(config, key)] = next;
+        fenwick[next] = 1;
+        next++;
+    }
+
+    // Linear-time Fenwick build from the point values
+    for (uint32_t i = 1; i <= capacity; i++) {
+        uint32_t parent = i + (i & (0u - i));
+        if (parent <= capacity) fenwick[parent - 1] += fenwick[i - 1];
+    }
+
+    free(set->owner);
+    free(set->fenwick);
+    set->owner = owner;
+    set->fenwick = fenwick;
+    set->capacity = capacity;
+    set->clock = next;
+    return true;
+}
+
+StackDistanceProfile* create_stack_distance_profile() {
+    StackDistanceProfile* profile = (StackDistanceProfile*)calloc(1, sizeof(StackDistanceProfile));
+    if (!profile) return NULL;
+
+    for (uint32_t bits = 0; bits <= SD_MAX_INDEX_BITS; bits++) {
+        SDConfig* config = &profile->configs[bits];
+        config->index_bits = bits;
+        config->num_sets = 1u << bits;
+        config->sets = (SDSet*)calloc(config->num_sets, sizeof(SDSet));
+        if (!config->sets || !grow_map(config)) {
+            free_stack_distance_profile(profile);
+            return NULL;
+        }
+    }
+    return profile;
+}
+
+void free_stack_distance_profile(StackDistanceProfile* profile) {
+    if (!profile) return;
+    for (uint32_t bits = 0; bits <= SD_MAX_INDEX_BITS; bits++) {
+        SDConfig* config = &profile->configs[bits];
+        if (config->sets) {
+            for (uint32_t s = 0; s < config->num_sets; s++) {
+                free(config->sets[s].fenwick);
+                free(config->sets[s].owner);
+            }
+            free(config->sets);
+        }
+        free(config->keys);
+        free(config->times);
+    }
+    free(profile);
+}
+
+static void config_access(SDConfig* config, uint32_t block) {
+    SDSet* set = &config->sets[block & (config->num_sets - 1)];
+    uint32_t key = block + 1;
+
+    if (set->clock == set->capacity && !compact_set(config, set)) {
+        fprintf(stderr, "Out of memory in stack-distance analysis\n");
+        exit(1);
+    }
+
+    uint32_t slot = map_slot(config, key);
+    if (config->keys[slot] == key) {
+        uint32_t previous = config->times[slot];
+        uint32_t distance = (uint32_t)(fenwick_prefix(set->fenwick, set->clock) -
+                                       fenwick_prefix(set->fenwick, previous + 1));
+        if (distance < SD_MAX_WAYS) {
+            config->histogram[distance]++;
+        } else {
+            config->far_accesses++;
+        }
+        fenwick_add(set->fenwick, set->capacity, previous, -1);
+        set->owner[previous] = 0;
+    } else {
+        config->cold_misses++;
+        set->live++;
+        // Keep the load factor at or below one half
+        if (2 * (config->map_size + 1) > config->map_capacity) {
+            if (!grow_map(config)) {
+                fprintf(stderr, "Out of memory in stack-distance analysis\n");
+                exit(1);
+            }
+            slot = map_slot(config, key);
+        }
+        config->keys[slot] = key;
+        config->map_size++;
+    }
+
+    config->times[slot] = set->clock;
+    set->owner[set->clock] = key;
+    fenwick_add(set->fenwick, set->capacity, set->clock, 1);
+    set->clock++;
+}
+
+void stack_distance_access(StackDistanceProfile* profile, uint32_t address) {
+    uint32_t block = address >> BLOCK_OFFSET_BITS;
+    profile->accesses++;
+    for (uint32_t bits = 0; bits <= SD_MAX_INDEX_BITS; bits++) {
+        config_access(&profile->configs[bits], block);
+    }
+}
+
+uint64_t stack_distance_misses(const StackDistanceProfile* profile, uint32_t index_bits, uint32_t ways) {
+    const SDConfig* config = &profile->configs[index_bits];
+    uint64_t misses = config->cold_misses + config->far_accesses;
+    for (uint32_t d = ways; d < SD_MAX_WAYS; d++) {
+        misses += config->histogram[d];
+    }
+    return misses;
+}
+
+void print_stack_distance_report(const StackDistanceProfile* profile) {
+    printf("===== LRU Stack-Distance Miss Curves =====\n");
+    printf("Accesses: %llu, block size: %d bytes\n",
+           (unsigned long long)profile->accesses, 1 << BLOCK_OFFSET_BITS);
+    printf("Compulsory misses: %llu\n", (unsigned long long)profile->configs[0].cold_misses);
+    printf("%8s %6s %10s %14s %9s\n", "Sets", "Ways", "Size", "Misses", "Miss rate");
+
+    for (uint32_t bits = 0; bits <= SD_MAX_INDEX_BITS; bits++) {
+        for (uint32_t ways = 1; ways <= SD_MAX_WAYS; ways *= 2) {
+            uint64_t size = ((uint64_t)1 << bits) * ways << BLOCK_OFFSET_BITS;
+            uint64_t misses = stack_distance_misses(profile, bits, ways);
+            char size_str[32];
+            if (size >= 1024 * 1024) {
+                snprintf(size_str, sizeof(size_str), "%lluMB", (unsigned long long)(size >> 20));
+            } else if (size >= 1024) {
+                snprintf(size_str, sizeof(size_str), "%lluKB", (unsigned long long)(size >> 10));
+            } else {
+                snprintf(size_str, sizeof(size_str), "%lluB", (unsigned long long)size);
+            }
+            printf("%8u %6u %10s %14llu %8.2f%%\n", 1u << bits, ways, size_str,
+                   (unsigned long long)misses,
+                   profile->accesses > 0 ? (double)misses / profile->accesses * 100 : 0);
+        }
+    }
+    printf("==========================================\n");
+}
@@ -0,0 +1,150 @@
+/**
+ * stats.cpp
+ * Statistics registry with JSON/CSV output and interval snapshots
+ */
+
+#include "stats.h"
+#include "cache_analysis.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+const char* stats_format_name(StatsFormat format) {
+    switch (format) {
+        case STATS_JSON: return "json";
+        case STATS_CSV: return "csv";
+    }
+    return "unknown";
+}
+
+bool parse_stats_format(const char* name, StatsFormat* format) {
+    if (strcasecmp(name, "json") == 0) {
+        *format = STATS_JSON;
+    } else if (strcasecmp(name, "csv") == 0) {
+        *format = STATS_CSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+StatsRegistry* create_stats_registry(const char* filename, StatsFormat format, uint64_t interval) {
+    StatsRegistry* registry = (StatsRegistry*)calloc(1, sizeof(StatsRegistry));
+    if (!registry) return NULL;
+    registry->file = fopen(filename, "w");
+    if (!registry->file) {
+        fprintf(stderr, "Failed to open statistics file: %s\n", filename);
+        free(registry);
+        return NULL;
+    }
+    registry->filename = filename;
+    registry->format = format;
+    registry->interval = interval;
+    return registry;
+}
+
+void free_stats_registry(StatsRegistry* registry) {
+    if (registry) {
+        if (registry->file) fclose(registry->file);
+        free(registry->entries);
+        free(registry);
+    }
+}
+
+bool stats_register(StatsRegistry* registry, const char* prefix, const char* name, const uint64_t* value) {
+    if (registry->count == registry->capacity) {
+        uint32_t capacity = registry->capacity ? registry->capacity * 2 : 64;
+        StatEntry* grown = (StatEntry*)realloc(registry->entries, sizeof(StatEntry) * capacity);
+        if (!grown) return false;
+        registry->entries = grown;
+        registry->capacity = capacity;
+    }
+
+    StatEntry* entry = &registry->entries[registry->count++];
+    if (prefix[0] != '\0') {
+        snprintf(entry->name, sizeof(entry->name), "%s.%s", prefix, name);
+    } else {
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+    }
+    entry->value = value;
+    return true;
+}
+
+bool stats_register_cache(StatsRegistry* registry, const char* prefix, const Cache* cache) {
+    bool ok = stats_register(registry, prefix, "accesses", &cache->accesses) &&
+              stats_register(registry, prefix, "hits", &cache->hits) &&
+              stats_register(registry, prefix, "misses", &cache->misses) &&
+              stats_register(registry, prefix, "write_backs", &cache->write_backs) &&
+              stats_register(registry, prefix, "prefetch_hits", &cache->prefetch_hits) &&
+              stats_register(registry, prefix, "prefetch_unused", &cache->prefetch_unused);
+    if (ok && cache->classifier) {
+        const MissClassifier* classifier = cache->classifier;
+        ok = stats_register(registry, prefix, "compulsory_misses", &classifier->compulsory) &&
+             stats_register(registry, prefix, "capacity_misses", &classifier->capacity_misses) &&
+             stats_register(registry, prefix, "conflict_misses", &classifier->conflict);
+    }
+    for (uint32_t b = 0; ok && cache->bank_accesses && b < cache->num_banks; b++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bank%u.accesses", b);
+        ok = stats_register(registry, prefix, name, &cache->bank_accesses[b]);
+    }
+    return ok;
+}
+
+// CSV needs the column names once, before the first row
+static void write_header(StatsRegistry* registry) {
+    if (registry->format == STATS_JSON) {
+        fprintf(registry->file, "{\n  \"intervals\": [");
+        return;
+    }
+    fprintf(registry->file, "kind,records");
+    for (uint32_t i = 0; i < registry->count; i++) {
+        fprintf(registry->file, ",%s", registry->entries[i].name);
+    }
+    fprintf(registry->file, "\n");
+}
+
+static void write_values(StatsRegistry* registry, const char* kind, uint64_t records) {
+    FILE* file = registry->file;
+    if (registry->format == STATS_CSV) {
+        fprintf(file, "%s,%llu", kind, (unsigned long long)records);
+        for (uint32_t i = 0; i < registry->count; i++) {
+            fprintf(file, ",%llu", (unsigned long long)*registry->entries[i].value);
+        }
+        fprintf(file, "\n");
+        return;
+    }
+
+    fprintf(file, "{\"records\": %llu", (unsigned long long)records);
+    for (uint32_t i = 0; i < registry->count; i++) {
+        fprintf(file, ", \"%s\": %llu", registry->entries[i].name,
+                (unsigned long long)*registry->entries[i].value);
+    }
+    fprintf(file, "}");
+}
+
+void stats_snapshot(StatsRegistry* registry, uint64_t records) {
+    if (registry->snapshots == 0) write_header(registry);
+    if (registry->format == STATS_JSON) {
+        fprintf(registry->file, registry->snapshots == 0 ? "\n    " : ",\n    ");
+    }
+    write_values(registry, "interval", records);
+    registry->snapshots++;
+}
+
+bool stats_finish(StatsRegistry* registry, uint64_t records) {
+    if (registry->snapshots == 0) write_header(registry);
+    if (registry->format == STATS_JSON) {
+        fprintf(registry->file, registry->snapshots == 0 ? "],\n  \"final\": " : "\n  ],\n  \"final\": ");
+        write_values(registry, "final", records);
+        fprintf(registry->file, "\n}\n");
+    } else {
+        write_values(registry, "final", records);
+    }
+
+    bool ok = !ferror(registry->file);
+    ok = fclose(registry->file) == 0 && ok;
+    registry->file = NULL;
+    if (!ok) fprintf(stderr, "Failed to write statistics file: %s\n", registry->filename);
+    return ok;
+}
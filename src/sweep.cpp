@@ -0,0 +1,399 @@
+/**
+ * sweep.cpp
+ * Multi-threaded design-space sweep over a shared in-memory trace
+ *
+ * The trace is parsed once into a read-only array. Every configuration
+ * gets its own controller, so jobs share nothing but the trace and run
+ * on a pool of worker threads. Each worker owns a contiguous range of
+ * job indices and steals half of another worker's remaining range when
+ * its own runs dry, which balances jobs of very different cost.
+ */
+
+#include "sweep.h"
+#include "config.h"
+#include "replacement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/**
+ * Job range owned by a worker, packed as (begin << 32 | end) so the owner
+ * and thieves can update both ends with a single compare-and-swap
+ */
+typedef struct {
+    alignas(64) uint64_t range;
+} WorkerQueue;
+
+typedef struct {
+    const TraceEntry* trace;
+    size_t trace_length;
+    SweepJob* jobs;
+    WorkerQueue* queues;
+    uint32_t num_workers;
+} SweepShared;
+
+typedef struct {
+    SweepShared* shared;
+    uint32_t id;
+} SweepWorker;
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+// Take the next job from the front of our own range; -1 if empty
+static int64_t pop_job(WorkerQueue* queue) {
+    uint64_t range = __atomic_load_n(&queue->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin >= end) return -1;
+        if (__atomic_compare_exchange_n(&queue->range, &range, pack_range(begin + 1, end),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return begin;
+        }
+    }
+}
+
+// Move the back half of a victim's range into our (empty) queue
+static bool steal_jobs(WorkerQueue* victim, WorkerQueue* own) {
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin >= end) return false;
+        uint32_t split = end - (end - begin + 1) / 2;
+        if (__atomic_compare_exchange_n(&victim->range, &range, pack_range(begin, split),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&own->range, pack_range(split, end), __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+}
+
+static void run_job(const SweepShared* shared, SweepJob* job) {
+    if (job->write_buffer) {
+        EnhancedCacheController* controller = create_enhanced_controller(&job->config);
+        if (!controller) return;
+        for (size_t i = 0; i < shared->trace_length; i++) {
+            simulate_trace_entry_enhanced(controller, &shared->trace[i]);
+        }
+        drain_write_buffer(controller);
+
+        job->l1_accesses = controller->L1->accesses;
+        job->l1_misses = controller->L1->misses;
+        job->l1_write_backs = controller->L1->write_backs;
+        job->l2_accesses = controller->L2->accesses;
+        job->l2_misses = controller->L2->misses;
+        job->l2_write_backs = controller->L2->write_backs;
+        job->wb_write_backs = controller->write_buffer->write_backs;
+        job->memory_accesses = controller->memory_accesses;
+        job->amat = timing_amat(&controller->timing);
+        free_enhanced_controller(controller);
+    } else {
+        CacheController* controller = create_cache_controller(&job->config);
+        if (!controller) return;
+        for (size_t i = 0; i < shared->trace_length; i++) {
+            simulate_trace_entry(controller, &shared->trace[i]);
+        }
+
+        job->l1_accesses = controller->L1->accesses;
+        job->l1_misses = controller->L1->misses;
+        job->l1_write_backs = controller->L1->write_backs;
+        job->l2_accesses = controller->L2->accesses;
+        job->l2_misses = controller->L2->misses;
+        job->l2_write_backs = controller->L2->write_backs;
+        job->wb_write_backs = 0;
+        job->memory_accesses = controller->memory_accesses;
+        job->amat = timing_amat(&controller->timing);
+        free_cache_controller(controller);
+    }
+    job->done = true;
+}
+
+static void* sweep_worker(void* arg) {
+    SweepWorker* worker = (SweepWorker*)arg;
+    SweepShared* shared = worker->shared;
+    WorkerQueue* own = &shared->queues[worker->id];
+
+    for (;;) {
+        int64_t job = pop_job(own);
+        if (job >= 0) {
+            run_job(shared, &shared->jobs[job]);
+            continue;
+        }
+
+        // Jobs are never added, so one full round of failed steals means we are done
+        bool stolen = false;
+        for (uint32_t k = 1; k < shared->num_workers && !stolen; k++) {
+            uint32_t victim = (worker->id + k) % shared->num_workers;
+            stolen = steal_jobs(&shared->queues[victim], own);
+        }
+        if (!stolen) break;
+    }
+    return NULL;
+}
+
+void run_sweep(const TraceEntry* trace, size_t trace_length, SweepJob* jobs, size_t num_jobs,
+               uint32_t threads) {
+    if (num_jobs == 0) return;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (threads > num_jobs) threads = (uint32_t)num_jobs;
+
+    SweepShared shared;
+    shared.trace = trace;
+    shared.trace_length = trace_length;
+    shared.jobs = jobs;
+    shared.num_workers = threads;
+    shared.queues = (WorkerQueue*)aligned_alloc(64, sizeof(WorkerQueue) * threads);
+    SweepWorker* workers = (SweepWorker*)malloc(sizeof(SweepWorker) * threads);
+    pthread_t* handles = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+    if (!shared.queues || !workers || !handles) {
+        fprintf(stderr, "Failed to allocate sweep workers\n");
+        free(shared.queues);
+        free(workers);
+        free(handles);
+        return;
+    }
+
+    // Contiguous initial ranges keep similar configurations on one worker
+    for (uint32_t w = 0; w < threads; w++) {
+        uint32_t begin = (uint32_t)(num_jobs * w / threads);
+        uint32_t end = (uint32_t)(num_jobs * (w + 1) / threads);
+        shared.queues[w].range = pack_range(begin, end);
+        workers[w].shared = &shared;
+        workers[w].id = w;
+    }
+
+    uint32_t started = 0;
+    for (uint32_t w = 1; w < threads; w++) {
+        if (pthread_create(&handles[w], NULL, sweep_worker, &workers[w]) != 0) break;
+        started = w;
+    }
+    // The calling thread is worker 0; it steals whatever failed to start
+    sweep_worker(&workers[0]);
+    for (uint32_t w = 1; w <= started; w++) {
+        pthread_join(handles[w], NULL);
+    }
+
+    free(shared.queues);
+    free(workers);
+    free(handles);
+}
+
+void default_sweep_grid(SweepGrid* grid) {
+    memset(grid, 0, sizeof(*grid));
+    grid->l1_sizes[grid->num_l1_sizes++] = L1_SIZE;
+    grid->l1_assocs[grid->num_l1_assocs++] = L1_ASSOCIATIVITY;
+    grid->l2_sizes[grid->num_l2_sizes++] = L2_SIZE;
+    grid->l2_assocs[grid->num_l2_assocs++] = L2_ASSOCIATIVITY;
+    grid->policies[grid->num_policies++] = LRU;
+    grid->write_buffer[grid->num_write_buffer++] = false;
+    grid->seed = DEFAULT_RANDOM_SEED;
+}
+
+// Split a comma-separated list into `out`; returns the count or -1
+static int parse_size_list(const char* text, uint32_t* out) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", text);
+    int n = 0;
+    for (char* tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == SWEEP_MAX_VALUES || !parse_size_value(tok, &out[n])) return -1;
+        n++;
+    }
+    return n > 0 ? n : -1;
+}
+
+int parse_sweep_option(SweepGrid* grid, int argc, char** argv, int index) {
+    const char* opt = argv[index];
+    if (index + 1 >= argc) return 0;
+    const char* value = argv[index + 1];
+    char buf[256];
+    int n;
+
+    if (strcmp(opt, "--l1-sizes") == 0) {
+        if ((n = parse_size_list(value, grid->l1_sizes)) < 0) return -1;
+        grid->num_l1_sizes = (uint32_t)n;
+    } else if (strcmp(opt, "--l1-assocs") == 0) {
+        if ((n = parse_size_list(value, grid->l1_assocs)) < 0) return -1;
+        grid->num_l1_assocs = (uint32_t)n;
+    } else if (strcmp(opt, "--l2-sizes") == 0) {
+        if ((n = parse_size_list(value, grid->l2_sizes)) < 0) return -1;
+        grid->num_l2_sizes = (uint32_t)n;
+    } else if (strcmp(opt, "--l2-assocs") == 0) {
+        if ((n = parse_size_list(value, grid->l2_assocs)) < 0) return -1;
+        grid->num_l2_assocs = (uint32_t)n;
+    } else if (strcmp(opt, "--policies") == 0) {
+        snprintf(buf, sizeof(buf), "%s", value);
+        grid->num_policies = 0;
+        for (char* tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+            if (grid->num_policies == SWEEP_MAX_VALUES ||
+                !parse_replacement_policy(tok, &grid->policies[grid->num_policies])) {
+                return -1;
+            }
+            grid->num_policies++;
+        }
+        if (grid->num_policies == 0) return -1;
+    } else if (strcmp(opt, "--write-buffer") == 0) {
+        snprintf(buf, sizeof(buf), "%s", value);
+        grid->num_write_buffer = 0;
+        for (char* tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+            if (grid->num_write_buffer == 2) return -1;
+            if (strcmp(tok, "on") == 0) grid->write_buffer[grid->num_write_buffer++] = true;
+            else if (strcmp(tok, "off") == 0) grid->write_buffer[grid->num_write_buffer++] = false;
+            else return -1;
+        }
+        if (grid->num_write_buffer == 0) return -1;
+    } else if (strcmp(opt, "--threads") == 0) {
+        char* end;
+        unsigned long v = strtoul(value, &end, 10);
+        if (*end != '\0') return -1;
+        grid->threads = (uint32_t)v;
+    } else if (strcmp(opt, "--seed") == 0) {
+        char* end;
+        grid->seed = strtoull(value, &end, 0);
+        if (end == value || *end != '\0') return -1;
+    } else {
+        return 0;
+    }
+    return 2;
+}
+
+SweepJob* build_sweep_jobs(const SweepGrid* grid, size_t* num_jobs) {
+    size_t total = (size_t)grid->num_l1_sizes * grid->num_l1_assocs * grid->num_l2_sizes *
+                   grid->num_l2_assocs * grid->num_policies * grid->num_write_buffer;
+    SweepJob* jobs = (SweepJob*)calloc(total ? total : 1, sizeof(SweepJob));
+    if (!jobs) return NULL;
+
+    size_t n = 0;
+    for (uint32_t a = 0; a < grid->num_l1_sizes; a++)
+    for (uint32_t b = 0; b < grid->num_l1_assocs; b++)
+    for (uint32_t c = 0; c < grid->num_l2_sizes; c++)
+    for (uint32_t d = 0; d < grid->num_l2_assocs; d++)
+    for (uint32_t p = 0; p < grid->num_policies; p++)
+    for (uint32_t w = 0; w < grid->num_write_buffer; w++) {
+        SweepJob* job = &jobs[n];
+        default_controller_config(&job->config);
+        // Only counters are reported, so never simulate block data
+        job->config.dataless = true;
+        job->write_buffer = grid->write_buffer[w];
+        job->config.seed = grid->seed;
+
+        if (!configure_cache_level(&job->config.l1, "L1", grid->l1_sizes[a], grid->l1_assocs[b],
+                                   grid->policies[p]) ||
+            !configure_cache_level(&job->config.l2, "L2", grid->l2_sizes[c], grid->l2_assocs[d],
+                                   grid->policies[p])) {
+            fprintf(stderr, "Skipping invalid geometry: L1 %u/%u-way, L2 %u/%u-way\n",
+                    grid->l1_sizes[a], grid->l1_assocs[b], grid->l2_sizes[c], grid->l2_assocs[d]);
+            continue;
+        }
+        n++;
+    }
+
+    *num_jobs = n;
+    return jobs;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole > 0 ? (double)part / whole * 100 : 0;
+}
+
+void print_sweep_table(const SweepJob* jobs, size_t num_jobs) {
+    printf("%8s %5s %8s %5s %7s %3s %8s %8s %10s %10s %10s %12s %8s\n",
+           "L1 size", "ways", "L2 size", "ways", "policy", "WB",
+           "L1 miss%", "L2 miss%", "L1 WBs", "L2 WBs", "Buf WBs", "Mem access", "AMAT");
+    for (size_t i = 0; i < num_jobs; i++) {
+        const SweepJob* job = &jobs[i];
+        if (!job->done) {
+            printf("%7uK %5u %7uK %5u %7s %3s  (failed to create controller)\n",
+                   job->config.l1.size >> 10, job->config.l1.associativity,
+                   job->config.l2.size >> 10, job->config.l2.associativity,
+                   replacement_policy_name(job->config.l1.policy), job->write_buffer ? "on" : "off");
+            continue;
+        }
+        printf("%7uK %5u %7uK %5u %7s %3s %7.2f%% %7.2f%% %10llu %10llu %10llu %12llu %8.2f\n",
+               job->config.l1.size >> 10, job->config.l1.associativity,
+               job->config.l2.size >> 10, job->config.l2.associativity,
+               replacement_policy_name(job->config.l1.policy), job->write_buffer ? "on" : "off",
+               percent(job->l1_misses, job->l1_accesses), percent(job->l2_misses, job->l2_accesses),
+               (unsigned long long)job->l1_write_backs, (unsigned long long)job->l2_write_backs,
+               (unsigned long long)job->wb_write_backs, (unsigned long long)job->memory_accesses,
+               job->amat);
+    }
+}
+
+static void print_sweep_usage(const char* prog) {
+    printf("Usage: %s sweep [options] <trace_file1> [trace_file2 ...]\n", prog);
+    printf("  --l1-sizes LIST     L1 sizes, e.g. 32K,64K (default 64K)\n");
+    printf("  --l1-assocs LIST    L1 associativities, e.g. 4,8 (default 8)\n");
+    printf("  --l2-sizes LIST     L2 sizes, e.g. 256K,1M (default 256K)\n");
+    printf("  --l2-assocs LIST    L2 associativities (default 16)\n");
+    printf("  --policies LIST     Replacement policies: lru,random,fifo,plru,\n"
+           "                      srrip,brrip,drrip (default lru)\n");
+    printf("  --write-buffer LIST off,on (default off)\n");
+    printf("  --threads N         Worker threads (default: one per CPU)\n");
+    printf("  --seed N            Random replacement seed for every job (default %d)\n",
+           DEFAULT_RANDOM_SEED);
+}
+
+int sweep_main(int argc, char** argv) {
+    SweepGrid grid;
+    default_sweep_grid(&grid);
+
+    int i = 2;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] == '-') {
+        int used = parse_sweep_option(&grid, argc, argv, i);
+        if (used <= 0) {
+            fprintf(stderr, "%s option: %s\n", used < 0 ? "Invalid value for" : "Unknown", argv[i]);
+            print_sweep_usage(argv[0]);
+            return 1;
+        }
+        i += used;
+    }
+    if (i >= argc) {
+        print_sweep_usage(argv[0]);
+        return 1;
+    }
+
+    // Parse every trace once into one shared, read-only buffer
+    TraceEntry* trace = NULL;
+    size_t trace_length = 0;
+    for (; i < argc; i++) {
+        TraceEntry* part = NULL;
+        size_t part_length = 0;
+        if (read_usimm_trace(argv[i], &part, &part_length) < 0) {
+            free(trace);
+            return 1;
+        }
+        TraceEntry* grown = (TraceEntry*)realloc(trace, sizeof(TraceEntry) * (trace_length + part_length + 1));
+        if (!grown) {
+            fprintf(stderr, "Failed to allocate memory for traces\n");
+            free(part);
+            free(trace);
+            return 1;
+        }
+        trace = grown;
+        memcpy(trace + trace_length, part, sizeof(TraceEntry) * part_length);
+        trace_length += part_length;
+        free(part);
+    }
+
+    size_t num_jobs = 0;
+    SweepJob* jobs = build_sweep_jobs(&grid, &num_jobs);
+    if (!jobs) {
+        fprintf(stderr, "Failed to allocate sweep jobs\n");
+        free(trace);
+        return 1;
+    }
+
+    printf("Sweeping %zu configurations over %zu trace records\n", num_jobs, trace_length);
+    run_sweep(trace, trace_length, jobs, num_jobs, grid.threads);
+    print_sweep_table(jobs, num_jobs);
+
+    free(jobs);
+    free(trace);
+    return 0;
+}
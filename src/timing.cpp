@@ -0,0 +1,118 @@
+/**
+ * timing.cpp
+ * Latency model: per-level service latencies, cycles and AMAT
+ */
+
+#include "timing.h"
+#include <stdio.h>
+#include <string.h>
+
+void default_latency_config(LatencyConfig* latency) {
+    latency->l1 = L1_HIT_LATENCY;
+    latency->l2 = L2_HIT_LATENCY;
+    latency->write_buffer = WRITE_BUFFER_LATENCY;
+    latency->victim = VICTIM_CACHE_LATENCY;
+    latency->memory = MEMORY_LATENCY;
+}
+
+void init_timing_stats(TimingStats* timing, const LatencyConfig* latency) {
+    memset(timing, 0, sizeof(*timing));
+    timing->latency = *latency;
+}
+
+uint32_t service_latency(const LatencyConfig* latency, ServiceLevel level) {
+    switch (level) {
+        case SERVICE_WRITE_BUFFER: return latency->write_buffer;
+        case SERVICE_L1: return latency->l1;
+        case SERVICE_VICTIM: return latency->l1 + latency->victim;
+        case SERVICE_L2: return latency->l1 + latency->l2;
+        case SERVICE_MEMORY: return latency->l1 + latency->l2 + latency->memory;
+        case SERVICE_LEVELS: break;
+    }
+    return 0;
+}
+
+void timing_record(TimingStats* timing, bool is_write, ServiceLevel level, uint32_t latency) {
+    timing->served[level]++;
+    if (is_write) {
+        timing->write_ops++;
+        timing->write_cycles += latency;
+    } else {
+        timing->read_ops++;
+        timing->read_cycles += latency;
+    }
+
+    uint32_t bucket = latency ? 32 - (uint32_t)__builtin_clz(latency) : 0;
+    if (bucket >= TIMING_HISTOGRAM_BUCKETS) bucket = TIMING_HISTOGRAM_BUCKETS - 1;
+    timing->histogram[bucket]++;
+}
+
+void merge_timing_stats(TimingStats* total, const TimingStats* part) {
+    total->cycles += part->cycles;
+    total->read_ops += part->read_ops;
+    total->write_ops += part->write_ops;
+    total->read_cycles += part->read_cycles;
+    total->write_cycles += part->write_cycles;
+    for (int i = 0; i < SERVICE_LEVELS; i++) {
+        total->served[i] += part->served[i];
+    }
+    for (int i = 0; i < TIMING_HISTOGRAM_BUCKETS; i++) {
+        total->histogram[i] += part->histogram[i];
+    }
+}
+
+static double average(uint64_t cycles, uint64_t ops) {
+    return ops > 0 ? (double)cycles / ops : 0;
+}
+
+double timing_amat(const TimingStats* timing) {
+    return average(timing->read_cycles + timing->write_cycles, timing->read_ops + timing->write_ops);
+}
+
+const char* service_level_name(ServiceLevel level) {
+    switch (level) {
+        case SERVICE_WRITE_BUFFER: return "write buffer";
+        case SERVICE_L1: return "L1";
+        case SERVICE_VICTIM: return "victim cache";
+        case SERVICE_L2: return "L2";
+        case SERVICE_MEMORY: return "memory";
+        case SERVICE_LEVELS: break;
+    }
+    return "unknown";
+}
+
+void print_timing_stats(const TimingStats* timing, bool victim_cache) {
+    const LatencyConfig* l = &timing->latency;
+    uint64_t ops = timing->read_ops + timing->write_ops;
+
+    printf("===== Timing Statistics =====\n");
+    printf("Latencies: L1 %u, L2 %u, write buffer %u, ", l->l1, l->l2, l->write_buffer);
+    if (victim_cache) printf("victim cache %u, ", l->victim);
+    printf("memory %u cycles\n", l->memory);
+    printf("Total cycles: %llu\n", (unsigned long long)timing->cycles);
+    printf("AMAT: %.2f cycles (reads %.2f, writes %.2f)\n", timing_amat(timing),
+           average(timing->read_cycles, timing->read_ops),
+           average(timing->write_cycles, timing->write_ops));
+
+    printf("Served by:");
+    for (int i = 0; i < SERVICE_LEVELS; i++) {
+        if (timing->served[i] == 0) continue;
+        printf(" %s %llu (%.2f%%)", service_level_name((ServiceLevel)i),
+               (unsigned long long)timing->served[i],
+               (double)timing->served[i] / ops * 100);
+    }
+    printf("\n");
+
+    printf("Latency histogram (cycles):\n");
+    for (int b = 0; b < TIMING_HISTOGRAM_BUCKETS; b++) {
+        if (timing->histogram[b] == 0) continue;
+        uint32_t low = b ? 1u << (b - 1) : 0;
+        char range[32];
+        if (b == TIMING_HISTOGRAM_BUCKETS - 1) snprintf(range, sizeof(range), "%u+", low);
+        else if (b <= 1) snprintf(range, sizeof(range), "%u", low);
+        else snprintf(range, sizeof(range), "%u-%u", low, (1u << b) - 1);
+        printf("  %12s: %llu (%.2f%%)\n", range, (unsigned long long)timing->histogram[b],
+               (double)timing->histogram[b] / ops * 100);
+    }
+    printf("=============================\n");
+}
@@ -0,0 +1,178 @@
+/**
+ * trace_binary.cpp
+ * Compact binary trace format
+ */
+
+#include "trace_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE_ESCAPE 15
+#define FLAG_PAYLOAD 0x40
+
+bool is_binary_trace(const void* bytes, size_t length) {
+    return length >= BINARY_TRACE_HEADER_SIZE &&
+           memcmp(bytes, BINARY_TRACE_MAGIC, BINARY_TRACE_MAGIC_SIZE) == 0;
+}
+
+uint64_t binary_trace_record_count(const void* header) {
+    const uint8_t* p = (const uint8_t*)header + BINARY_TRACE_MAGIC_SIZE;
+    uint64_t count = 0;
+    for (int i = 7; i >= 0; i--) {
+        count = (count << 8) | p[i];
+    }
+    return count;
+}
+
+void write_binary_trace_header(uint8_t* header, uint64_t record_count) {
+    memcpy(header, BINARY_TRACE_MAGIC, BINARY_TRACE_MAGIC_SIZE);
+    for (int i = 0; i < 8; i++) {
+        header[BINARY_TRACE_MAGIC_SIZE + i] = (uint8_t)(record_count >> (8 * i));
+    }
+}
+
+static inline size_t put_varint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// Returns bytes consumed, or 0 if the varint runs past `end` or 5 bytes
+static inline size_t get_varint(const uint8_t* p, const uint8_t* end, uint32_t* value) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < 5 && p + n < end; n++) {
+        result |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+size_t encode_binary_record(const TraceEntry* entry, uint32_t* prev_address, uint8_t* out) {
+    size_t payload = entry->size < sizeof(entry->data) ? entry->size : sizeof(entry->data);
+    bool has_payload = false;
+    for (size_t i = 0; i < payload; i++) {
+        has_payload |= entry->data[i] != 0;
+    }
+
+    uint8_t size_field = entry->size < SIZE_ESCAPE ? (uint8_t)entry->size : SIZE_ESCAPE;
+    out[0] = (uint8_t)((entry->op & 0x3) | (size_field << 2) | (has_payload ? FLAG_PAYLOAD : 0));
+    size_t n = 1;
+
+    int32_t delta = (int32_t)(entry->address - *prev_address);
+    n += put_varint(out + n, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+    *prev_address = entry->address;
+
+    if (size_field == SIZE_ESCAPE) {
+        n += put_varint(out + n, entry->size);
+    }
+    if (has_payload) {
+        memcpy(out + n, entry->data, payload);
+        n += payload;
+    }
+    return n;
+}
+
+size_t decode_binary_record(const uint8_t* p, const uint8_t* end, uint32_t* prev_address,
+                            TraceEntry* entry) {
+    if (p >= end) return 0;
+    uint8_t header = p[0];
+    size_t n = 1;
+
+    uint32_t zigzag;
+    size_t used = get_varint(p + n, end, &zigzag);
+    if (!used) return 0;
+    n += used;
+    int32_t delta = (int32_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+
+    uint32_t size = (header >> 2) & 0xF;
+    if (size == SIZE_ESCAPE) {
+        used = get_varint(p + n, end, &size);
+        if (!used) return 0;
+        n += used;
+    }
+
+    memset(entry->data, 0, sizeof(entry->data));
+    if (header & FLAG_PAYLOAD) {
+        size_t payload = size < sizeof(entry->data) ? size : sizeof(entry->data);
+        if ((size_t)(end - p) < n + payload) return 0;
+        memcpy(entry->data, p + n, payload);
+        n += payload;
+    }
+
+    entry->op = (TraceOperation)(header & 0x3);
+    entry->address = *prev_address + (uint32_t)delta;
+    entry->size = size;
+    *prev_address = entry->address;
+    return n;
+}
+
+int convert_trace_to_binary(const char* input, const char* output) {
+    TraceReader* reader = open_trace_reader(input);
+    if (!reader) return -1;
+
+    bool to_stdout = strcmp(output, "-") == 0;
+    FILE* out = to_stdout ? stdout : fopen(output, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open output file: %s\n", output);
+        close_trace_reader(reader);
+        return -1;
+    }
+
+    // The count is patched in at the end when the output is seekable
+    uint8_t header[BINARY_TRACE_HEADER_SIZE];
+    write_binary_trace_header(header, BINARY_TRACE_UNKNOWN_COUNT);
+    fwrite(header, 1, sizeof(header), out);
+
+    TraceEntry chunk[TRACE_CHUNK_ENTRIES];
+    uint8_t* encoded = (uint8_t*)malloc(TRACE_CHUNK_ENTRIES * BINARY_TRACE_MAX_RECORD);
+    if (!encoded) {
+        fprintf(stderr, "Failed to allocate conversion buffer\n");
+        if (!to_stdout) fclose(out);
+        close_trace_reader(reader);
+        return -1;
+    }
+
+    uint32_t prev_address = 0;
+    uint64_t records = 0;
+    size_t got;
+    int status = 0;
+
+    while ((got = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_ENTRIES)) > 0) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < got; i++) {
+            bytes += encode_binary_record(&chunk[i], &prev_address, encoded + bytes);
+        }
+        if (fwrite(encoded, 1, bytes, out) != bytes) {
+            fprintf(stderr, "Failed to write binary trace: %s\n", output);
+            status = -1;
+            break;
+        }
+        records += got;
+    }
+
+    if (status == 0 && !to_stdout && fseek(out, 0, SEEK_SET) == 0) {
+        write_binary_trace_header(header, records);
+        fwrite(header, 1, sizeof(header), out);
+    }
+
+    // Keep stdout clean when it carries the converted trace
+    fprintf(to_stdout ? stderr : stdout, "Converted %llu records from %s to %s\n",
+            (unsigned long long)records, input, output);
+
+    free(encoded);
+    if (to_stdout) {
+        fflush(out);
+    } else if (fclose(out) != 0) {
+        status = -1;
+    }
+    close_trace_reader(reader);
+    return status;
+}
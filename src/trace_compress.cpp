@@ -0,0 +1,376 @@
+/**
+ * trace_compress.cpp
+ * Compressed trace input decoded on a background thread
+ *
+ * A decoder thread reads the compressed file and fills fixed-size blocks
+ * of plain text (or binary trace) data; the trace reader drains them with
+ * compressed_stream_read. Disk reads and decompression therefore overlap
+ * with parsing and simulation on the main thread.
+ */
+
+#include "trace_compress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define COMPRESSED_INPUT_SIZE (128 * 1024)
+
+typedef struct {
+    uint8_t data[DECOMPRESS_BLOCK_SIZE];
+    size_t length;
+} DecompressBlock;
+
+struct CompressedStream {
+    int fd;
+    TraceCompression kind;
+    uint8_t* prefix;
+    size_t prefix_length;
+    size_t prefix_offset;
+    pthread_t thread;
+
+    // Bounded queue of filled blocks, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    DecompressBlock* blocks;
+    uint32_t head;          // Next block for the reader
+    uint32_t filled;        // Blocks ready for the reader
+    bool finished;          // Decoder reached end of input
+    bool failed;            // Decoder hit an error
+    bool stopping;          // Reader closed the stream early
+
+    // Reader position inside the block at head
+    size_t read_offset;
+};
+
+static const uint8_t gzip_magic[] = { 0x1F, 0x8B };
+static const uint8_t zstd_magic[] = { 0x28, 0xB5, 0x2F, 0xFD };
+
+TraceCompression detect_trace_compression(const void* head, size_t length) {
+    if (length >= sizeof(gzip_magic) && memcmp(head, gzip_magic, sizeof(gzip_magic)) == 0) {
+        return TRACE_GZIP;
+    }
+    if (length >= sizeof(zstd_magic) && memcmp(head, zstd_magic, sizeof(zstd_magic)) == 0) {
+        return TRACE_ZSTD;
+    }
+    return TRACE_UNCOMPRESSED;
+}
+
+bool trace_compression_supported(TraceCompression kind) {
+    switch (kind) {
+        case TRACE_UNCOMPRESSED:
+            return true;
+        case TRACE_GZIP:
+#ifdef HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        case TRACE_ZSTD:
+#ifdef HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* trace_compression_name(TraceCompression kind) {
+    switch (kind) {
+        case TRACE_GZIP: return "gzip";
+        case TRACE_ZSTD: return "zstd";
+        default: return "uncompressed";
+    }
+}
+
+// Read more compressed input; returns bytes read, 0 at EOF, -1 on error
+static ssize_t read_input(CompressedStream* stream, uint8_t* buf, size_t len) {
+    if (stream->prefix_offset < stream->prefix_length) {
+        size_t n = stream->prefix_length - stream->prefix_offset;
+        if (n > len) n = len;
+        memcpy(buf, stream->prefix + stream->prefix_offset, n);
+        stream->prefix_offset += n;
+        return (ssize_t)n;
+    }
+
+    int fd = stream->fd;
+    ssize_t got;
+    do {
+        got = read(fd, buf, len);
+    } while (got < 0 && errno == EINTR);
+    return got;
+}
+
+/**
+ * Wait for a free block and return it, or NULL if the reader is closing.
+ * The returned block is owned by the decoder until publish_block.
+ */
+static DecompressBlock* acquire_block(CompressedStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    while (stream->filled == DECOMPRESS_QUEUE_BLOCKS && !stream->stopping) {
+        pthread_cond_wait(&stream->not_full, &stream->lock);
+    }
+    DecompressBlock* block = NULL;
+    if (!stream->stopping) {
+        block = &stream->blocks[(stream->head + stream->filled) % DECOMPRESS_QUEUE_BLOCKS];
+        block->length = 0;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return block;
+}
+
+static void publish_block(CompressedStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->filled++;
+    pthread_cond_signal(&stream->not_empty);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+static void finish_stream(CompressedStream* stream, bool failed) {
+    pthread_mutex_lock(&stream->lock);
+    stream->finished = true;
+    stream->failed = failed;
+    pthread_cond_broadcast(&stream->not_empty);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+#ifdef HAVE_ZLIB
+static bool decode_gzip(CompressedStream* stream, uint8_t* input) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // 15 + 32: maximum window, auto-detect gzip or zlib headers
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) return false;
+
+    bool ok = true;
+    bool input_done = false;
+    DecompressBlock* block = NULL;
+
+    while (ok) {
+        if (zs.avail_in == 0 && !input_done) {
+            ssize_t got = read_input(stream, input, COMPRESSED_INPUT_SIZE);
+            if (got < 0) { ok = false; break; }
+            if (got == 0) input_done = true;
+            zs.next_in = input;
+            zs.avail_in = (uInt)got;
+        }
+        if (!block && !(block = acquire_block(stream))) break;
+
+        zs.next_out = block->data + block->length;
+        zs.avail_out = (uInt)(DECOMPRESS_BLOCK_SIZE - block->length);
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        block->length = DECOMPRESS_BLOCK_SIZE - zs.avail_out;
+
+        if (ret == Z_STREAM_END) {
+            // Concatenated gzip members are decoded back to back
+            if (zs.avail_in == 0 && !input_done) {
+                ssize_t got = read_input(stream, input, COMPRESSED_INPUT_SIZE);
+                if (got < 0) { ok = false; break; }
+                if (got == 0) input_done = true;
+                zs.next_in = input;
+                zs.avail_in = (uInt)got;
+            }
+            if (zs.avail_in == 0 && input_done) {
+                if (block->length > 0) publish_block(stream);
+                block = NULL;
+                break;
+            }
+            inflateReset(&zs);
+        } else if (ret == Z_BUF_ERROR && input_done && zs.avail_in == 0) {
+            fprintf(stderr, "Truncated gzip trace\n");
+            ok = false;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf(stderr, "Corrupt gzip trace: %s\n", zs.msg ? zs.msg : "inflate failed");
+            ok = false;
+        }
+
+        if (block->length == DECOMPRESS_BLOCK_SIZE) {
+            publish_block(stream);
+            block = NULL;
+        }
+    }
+
+    if (block && block->length > 0) publish_block(stream);
+    inflateEnd(&zs);
+    return ok;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static bool decode_zstd(CompressedStream* stream, uint8_t* input) {
+    ZSTD_DStream* zds = ZSTD_createDStream();
+    if (!zds) return false;
+    ZSTD_initDStream(zds);
+
+    bool ok = true;
+    bool input_done = false;
+    bool flush_pending = false;   // Last call filled its output; more may be buffered
+    size_t last_ret = 0;
+    ZSTD_inBuffer in = { input, 0, 0 };
+    DecompressBlock* block = NULL;
+
+    while (ok) {
+        if (in.pos == in.size && !input_done) {
+            ssize_t got = read_input(stream, input, COMPRESSED_INPUT_SIZE);
+            if (got < 0) { ok = false; break; }
+            if (got == 0) {
+                input_done = true;
+            } else {
+                in.size = (size_t)got;
+                in.pos = 0;
+            }
+        }
+        if (in.pos == in.size && input_done && !flush_pending) break;
+        if (!block && !(block = acquire_block(stream))) break;
+
+        ZSTD_outBuffer out = { block->data, DECOMPRESS_BLOCK_SIZE, block->length };
+        last_ret = ZSTD_decompressStream(zds, &out, &in);
+        if (ZSTD_isError(last_ret)) {
+            fprintf(stderr, "Corrupt zstd trace: %s\n", ZSTD_getErrorName(last_ret));
+            ok = false;
+        }
+        flush_pending = out.pos == out.size;
+        block->length = out.pos;
+
+        if (block->length == DECOMPRESS_BLOCK_SIZE) {
+            publish_block(stream);
+            block = NULL;
+        }
+    }
+
+    if (ok && last_ret != 0) {
+        fprintf(stderr, "Truncated zstd trace\n");
+        ok = false;
+    }
+    if (block && block->length > 0) publish_block(stream);
+    ZSTD_freeDStream(zds);
+    return ok;
+}
+#endif
+
+static void* decoder_thread(void* arg) {
+    CompressedStream* stream = (CompressedStream*)arg;
+    uint8_t* input = (uint8_t*)malloc(COMPRESSED_INPUT_SIZE);
+    bool ok = false;
+
+    if (input) {
+        switch (stream->kind) {
+#ifdef HAVE_ZLIB
+            case TRACE_GZIP:
+                ok = decode_gzip(stream, input);
+                break;
+#endif
+#ifdef HAVE_ZSTD
+            case TRACE_ZSTD:
+                ok = decode_zstd(stream, input);
+                break;
+#endif
+            default:
+                break;
+        }
+    }
+
+    free(input);
+    finish_stream(stream, !ok);
+    return NULL;
+}
+
+CompressedStream* open_compressed_stream(int fd, TraceCompression kind,
+                                         const void* prefix, size_t prefix_length) {
+    if (!trace_compression_supported(kind) || kind == TRACE_UNCOMPRESSED) {
+        fprintf(stderr, "This build cannot read %s traces\n", trace_compression_name(kind));
+        return NULL;
+    }
+
+    CompressedStream* stream = (CompressedStream*)calloc(1, sizeof(CompressedStream));
+    if (!stream) return NULL;
+    stream->blocks = (DecompressBlock*)malloc(sizeof(DecompressBlock) * DECOMPRESS_QUEUE_BLOCKS);
+    if (!stream->blocks) {
+        free(stream);
+        return NULL;
+    }
+
+    stream->fd = fd;
+    stream->kind = kind;
+    if (prefix_length > 0) {
+        stream->prefix = (uint8_t*)malloc(prefix_length);
+        if (!stream->prefix) {
+            free(stream->blocks);
+            free(stream);
+            return NULL;
+        }
+        memcpy(stream->prefix, prefix, prefix_length);
+        stream->prefix_length = prefix_length;
+    }
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->not_empty, NULL);
+    pthread_cond_init(&stream->not_full, NULL);
+
+    if (pthread_create(&stream->thread, NULL, decoder_thread, stream) != 0) {
+        fprintf(stderr, "Failed to start decompression thread\n");
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->not_empty);
+        pthread_cond_destroy(&stream->not_full);
+        free(stream->prefix);
+        free(stream->blocks);
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+ssize_t compressed_stream_read(CompressedStream* stream, void* buf, size_t len) {
+    pthread_mutex_lock(&stream->lock);
+    while (stream->filled == 0 && !stream->finished) {
+        pthread_cond_wait(&stream->not_empty, &stream->lock);
+    }
+    if (stream->filled == 0) {
+        bool failed = stream->failed;
+        pthread_mutex_unlock(&stream->lock);
+        return failed ? -1 : 0;
+    }
+    DecompressBlock* block = &stream->blocks[stream->head];
+    pthread_mutex_unlock(&stream->lock);
+
+    // The block at head is ours until we release it below
+    size_t available = block->length - stream->read_offset;
+    size_t n = len < available ? len : available;
+    memcpy(buf, block->data + stream->read_offset, n);
+    stream->read_offset += n;
+
+    if (stream->read_offset == block->length) {
+        stream->read_offset = 0;
+        pthread_mutex_lock(&stream->lock);
+        stream->head = (stream->head + 1) % DECOMPRESS_QUEUE_BLOCKS;
+        stream->filled--;
+        pthread_cond_signal(&stream->not_full);
+        pthread_mutex_unlock(&stream->lock);
+    }
+    return (ssize_t)n;
+}
+
+void close_compressed_stream(CompressedStream* stream) {
+    if (!stream) return;
+
+    pthread_mutex_lock(&stream->lock);
+    stream->stopping = true;
+    pthread_cond_broadcast(&stream->not_full);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->not_empty);
+    pthread_cond_destroy(&stream->not_full);
+    free(stream->prefix);
+    free(stream->blocks);
+    free(stream);
+}
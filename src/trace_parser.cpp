@@ -5,190 +5,667 @@
 
 #include "trace_parser.h"
 #include "controller.h"
+#include "trace_binary.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-static void hex_string_to_bytes(const char* hex_str, uint8_t* bytes, int num_bytes) {
+// Nibble value of each character, 0xFF for anything that is not a hex digit
+static uint8_t hex_value[256];
+static bool hex_table_ready = false;
+
+static void init_hex_table(void) {
+    if (hex_table_ready) return;
+    memset(hex_value, 0xFF, sizeof(hex_value));
+    for (int c = '0'; c <= '9'; c++) hex_value[c] = (uint8_t)(c - '0');
+    for (int c = 'a'; c <= 'f'; c++) hex_value[c] = (uint8_t)(c - 'a' + 10);
+    for (int c = 'A'; c <= 'F'; c++) hex_value[c] = (uint8_t)(c - 'A' + 10);
+    hex_table_ready = true;
+}
+
+/**
+ * Decode `num_bytes` (<= 8) bytes from a validated run of hex digits.
+ * Digits map to nibbles without branches: (c & 0xF) + 9 for letters,
+ * which have bit 0x40 set. With SSE2 all 16 digits are decoded at once
+ * when the buffer has 16 readable bytes; otherwise the scalar loop runs.
+ */
+static void decode_hex_bytes(const char* hex, const char* buf_end, uint8_t* bytes, int num_bytes) {
+#if defined(__SSE2__)
+    if (buf_end - hex >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)hex);
+        __m128i low = _mm_and_si128(c, _mm_set1_epi8(0x0F));
+        __m128i alpha = _mm_cmpeq_epi8(_mm_and_si128(c, _mm_set1_epi8(0x40)), _mm_set1_epi8(0x40));
+        __m128i nib = _mm_add_epi8(low, _mm_and_si128(alpha, _mm_set1_epi8(9)));
+        // Each 16-bit lane holds (high nibble, low nibble) -> (high << 4) | low
+        __m128i hi = _mm_slli_epi16(_mm_and_si128(nib, _mm_set1_epi16(0x00FF)), 4);
+        __m128i lo = _mm_srli_epi16(nib, 8);
+        __m128i packed = _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128());
+        uint8_t out[16];
+        _mm_storeu_si128((__m128i*)out, packed);
+        memcpy(bytes, out, num_bytes);
+        return;
+    }
+#else
+    (void)buf_end;
+#endif
     for (int i = 0; i < num_bytes; i++) {
-        sscanf(hex_str + 2*i, "%2hhx", &bytes[i]);
+        uint8_t h = (uint8_t)hex[2*i], l = (uint8_t)hex[2*i + 1];
+        uint8_t hn = (h & 0x0F) + 9 * ((h >> 6) & 1);
+        uint8_t ln = (l & 0x0F) + 9 * ((l >> 6) & 1);
+        bytes[i] = (uint8_t)((hn << 4) | ln);
     }
 }
 
-int read_usimm_trace(const char* filename, TraceEntry** traces, int* num_traces) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Failed to open trace file: %s\n", filename);
-        return -1;
+static inline const char* skip_blanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/**
+ * Parse one "<op> <hex addr>[, <size>[, <hex data>]]" record in place.
+ * `end` points at the line terminator. Returns false for comments,
+ * blank or malformed lines and unknown operations, as the old
+ * sscanf-based reader did.
+ */
+static bool parse_trace_line(const char* p, const char* end, TraceEntry* entry) {
+    if (p >= end || *p == '#') return false;
+
+    char op = (char)toupper((unsigned char)*p++);
+    p = skip_blanks(p, end);
+
+    // Address (an optional 0x prefix is accepted, as with %x)
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+    const char* digits = p;
+    uint32_t address = 0;
+    while (p < end && hex_value[(uint8_t)*p] < 16) {
+        address = (address << 4) | hex_value[(uint8_t)*p];
+        p++;
+    }
+    if (p == digits) return false;  // Skip malformed lines
+
+    // Optional ", <size>"
+    int parsed = 2;
+    uint32_t size = 0;
+    p = skip_blanks(p, end);
+    if (p < end && *p == ',') {
+        p = skip_blanks(p + 1, end);
+        const char* size_digits = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            size = size * 10 + (uint32_t)(*p - '0');
+            p++;
+        }
+        if (p > size_digits) parsed = 3;
+    }
+
+    // Optional ", <hex data>"
+    const char* hex = NULL;
+    int hex_digits = 0;
+    if (parsed == 3) {
+        p = skip_blanks(p, end);
+        if (p < end && *p == ',') {
+            p = skip_blanks(p + 1, end);
+            hex = p;
+            while (p < end && hex_value[(uint8_t)*p] < 16) p++;
+            hex_digits = (int)(p - hex);
+            if (hex_digits > 0) parsed = 4;
+        }
+    }
+
+    entry->address = address;
+    memset(entry->data, 0, sizeof(entry->data));
+
+    switch (op) {
+        case 'I':
+            entry->op = TRACE_INSTRUCTION;
+            entry->size = (parsed >= 3) ? size : 0;
+            return true;
+        case 'L':
+            entry->op = TRACE_LOAD;
+            entry->size = (parsed >= 3) ? size : 4;  // Default to 4 bytes
+            return true;
+        case 'S':
+        case 'M':
+            entry->op = (op == 'S') ? TRACE_STORE : TRACE_MODIFY;
+            entry->size = (parsed >= 3) ? size : 4;  // Default to 4 bytes
+            if (parsed >= 4) {
+                int num_bytes = hex_digits / 2;
+                if (num_bytes > (int)entry->size) num_bytes = (int)entry->size;
+                if (num_bytes > (int)sizeof(entry->data)) num_bytes = (int)sizeof(entry->data);
+                decode_hex_bytes(hex, end, entry->data, num_bytes);
+            }
+            return true;
+        default:
+            return false;  // Skip unknown operations
+    }
+}
+
+// Input buffer for non-mappable sources; any single line must fit in it
+#define TRACE_READ_BUFFER_SIZE (1 << 20)
+// Consumed mapped pages are dropped in steps of this size to bound RSS
+#define TRACE_RELEASE_STEP (64u << 20)
+
+static void refill_trace_buffer(TraceReader* reader);
+
+// Look for a binary trace header and skip past it
+static void detect_trace_format(TraceReader* reader) {
+    const char* start;
+    size_t available;
+
+    if (reader->map) {
+        start = reader->map;
+        available = reader->map_length;
+    } else {
+        while (!reader->eof && reader->buffer_end < BINARY_TRACE_HEADER_SIZE) {
+            refill_trace_buffer(reader);
+        }
+        start = reader->buffer;
+        available = reader->buffer_end;
+    }
+
+    reader->declared_records = BINARY_TRACE_UNKNOWN_COUNT;
+    if (!is_binary_trace(start, available)) return;
+
+    reader->binary = true;
+    reader->declared_records = binary_trace_record_count(start);
+    if (reader->map) {
+        reader->map_pos = BINARY_TRACE_HEADER_SIZE;
+    } else {
+        reader->buffer_start = BINARY_TRACE_HEADER_SIZE;
+    }
+}
+
+TraceReader* open_trace_reader(const char* filename) {
+    init_hex_table();
+
+    TraceReader* reader = (TraceReader*)calloc(1, sizeof(TraceReader));
+    if (!reader) return NULL;
+
+    if (strcmp(filename, "-") == 0) {
+        reader->fd = STDIN_FILENO;
+        reader->owns_fd = false;
+    } else {
+        reader->fd = open(filename, O_RDONLY);
+        reader->owns_fd = true;
+        if (reader->fd < 0) {
+            fprintf(stderr, "Failed to open trace file: %s\n", filename);
+            free(reader);
+            return NULL;
+        }
+    }
+
+    struct stat st;
+    if (fstat(reader->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map != MAP_FAILED) {
+            TraceCompression compression = detect_trace_compression(map, (size_t)st.st_size);
+            if (compression == TRACE_UNCOMPRESSED) {
+                madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+                reader->map = (const char*)map;
+                reader->map_length = (size_t)st.st_size;
+                detect_trace_format(reader);
+                return reader;
+            }
+
+            // Compressed files are decoded by a background thread instead
+            munmap(map, (size_t)st.st_size);
+            reader->stream = open_compressed_stream(reader->fd, compression, NULL, 0);
+            if (!reader->stream) {
+                fprintf(stderr, "Failed to open compressed trace: %s\n", filename);
+                close_trace_reader(reader);
+                return NULL;
+            }
+        }
+    }
+
+    // Pipes, FIFOs, stdin, compressed input, or files that could not be mapped
+    reader->buffer = (char*)malloc(TRACE_READ_BUFFER_SIZE);
+    if (!reader->buffer) {
+        fprintf(stderr, "Failed to allocate trace buffer\n");
+        close_trace_reader(reader);
+        return NULL;
+    }
+    reader->buffer_capacity = TRACE_READ_BUFFER_SIZE;
+
+    if (!reader->stream) {
+        // Peek at piped input for a compression magic; whatever was read
+        // while peeking is handed to the decoder as the start of its input
+        while (!reader->eof && reader->buffer_end < TRACE_MAGIC_PEEK) {
+            refill_trace_buffer(reader);
+        }
+        TraceCompression compression = detect_trace_compression(reader->buffer, reader->buffer_end);
+        if (compression != TRACE_UNCOMPRESSED) {
+            reader->stream = open_compressed_stream(reader->fd, compression,
+                                                    reader->buffer, reader->buffer_end);
+            if (!reader->stream) {
+                fprintf(stderr, "Failed to open compressed trace: %s\n", filename);
+                close_trace_reader(reader);
+                return NULL;
+            }
+            reader->buffer_end = 0;
+            reader->eof = false;
+        }
+    }
+
+    detect_trace_format(reader);
+    return reader;
+}
+
+void close_trace_reader(TraceReader* reader) {
+    if (!reader) return;
+    if (reader->map) munmap((void*)reader->map, reader->map_length);
+    close_compressed_stream(reader->stream);
+    if (reader->owns_fd && reader->fd >= 0) close(reader->fd);
+    free(reader->buffer);
+    free(reader);
+}
+
+// Refill the read buffer, keeping the unconsumed partial line at the front
+static void refill_trace_buffer(TraceReader* reader) {
+    if (reader->eof) return;
+
+    size_t pending = reader->buffer_end - reader->buffer_start;
+    if (reader->buffer_start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->buffer_start, pending);
+        reader->buffer_start = 0;
+        reader->buffer_end = pending;
+    }
+
+    // One read per refill: hand back whatever arrived rather than
+    // blocking until a slow pipe fills the whole buffer
+    ssize_t got;
+    if (reader->stream) {
+        got = compressed_stream_read(reader->stream, reader->buffer + reader->buffer_end,
+                                     reader->buffer_capacity - reader->buffer_end);
+        if (got < 0) errno = EIO;
+    } else {
+        do {
+            got = read(reader->fd, reader->buffer + reader->buffer_end,
+                       reader->buffer_capacity - reader->buffer_end);
+        } while (got < 0 && errno == EINTR);
+    }
+
+    if (got < 0) {
+        fprintf(stderr, "Failed to read trace input: %s\n", strerror(errno));
+        reader->eof = true;
+    } else if (got == 0) {
+        reader->eof = true;
+    } else {
+        reader->buffer_end += (size_t)got;
+    }
+}
+
+// Let the kernel drop mapped pages we have already parsed
+static void release_consumed_pages(TraceReader* reader) {
+    if (reader->map_pos - reader->map_released >= TRACE_RELEASE_STEP) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t release_end = reader->map_pos & ~(page - 1);
+        madvise((void*)(reader->map + reader->map_released),
+                release_end - reader->map_released, MADV_DONTNEED);
+        reader->map_released = release_end;
+    }
+}
+
+static size_t next_chunk_mapped(TraceReader* reader, TraceEntry* entries, size_t max_entries) {
+    size_t count = 0;
+    const char* p = reader->map + reader->map_pos;
+    const char* end = reader->map + reader->map_length;
+
+    while (count < max_entries && p < end) {
+        const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        if (parse_trace_line(p, eol, &entries[count])) {
+            count++;
+        }
+        p = eol + 1;
+    }
+    reader->map_pos = (p < end) ? (size_t)(p - reader->map) : reader->map_length;
+    release_consumed_pages(reader);
+    return count;
+}
+
+static size_t next_chunk_buffered(TraceReader* reader, TraceEntry* entries, size_t max_entries) {
+    size_t count = 0;
+
+    while (count < max_entries) {
+        const char* p = reader->buffer + reader->buffer_start;
+        const char* end = reader->buffer + reader->buffer_end;
+        const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+
+        if (!eol) {
+            if (!reader->eof && reader->buffer_end - reader->buffer_start < reader->buffer_capacity) {
+                // Incomplete line: stop here if we already have records,
+                // otherwise wait for more input
+                if (count > 0) break;
+                refill_trace_buffer(reader);
+                continue;
+            }
+            if (p == end) break;
+            eol = end;  // Last line without a terminator, or an over-long line
+        }
+
+        if (parse_trace_line(p, eol, &entries[count])) {
+            count++;
+        }
+        reader->buffer_start = (eol < end) ? (size_t)(eol + 1 - reader->buffer) : reader->buffer_end;
+    }
+    return count;
+}
+
+static size_t next_chunk_binary(TraceReader* reader, TraceEntry* entries, size_t max_entries) {
+    size_t count = 0;
+
+    if (reader->map) {
+        const uint8_t* p = (const uint8_t*)reader->map + reader->map_pos;
+        const uint8_t* end = (const uint8_t*)reader->map + reader->map_length;
+        while (count < max_entries) {
+            size_t used = decode_binary_record(p, end, &reader->last_address, &entries[count]);
+            if (!used) break;
+            p += used;
+            count++;
+        }
+        if (count < max_entries && p < end) {
+            fprintf(stderr, "Truncated record at end of binary trace\n");
+            p = end;
+        }
+        reader->map_pos = (size_t)(p - (const uint8_t*)reader->map);
+        release_consumed_pages(reader);
+        return count;
     }
-    
-    char line[256];
-    int count = 0;
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '#' || line[0] == '\n') continue;
-        count++;
+
+    while (count < max_entries) {
+        const uint8_t* p = (const uint8_t*)reader->buffer + reader->buffer_start;
+        const uint8_t* end = (const uint8_t*)reader->buffer + reader->buffer_end;
+        size_t used = decode_binary_record(p, end, &reader->last_address, &entries[count]);
+        if (used) {
+            reader->buffer_start += used;
+            count++;
+            continue;
+        }
+
+        // Incomplete record at the end of the buffer
+        if (reader->eof) {
+            if (p < end) {
+                fprintf(stderr, "Truncated record at end of binary trace\n");
+                reader->buffer_start = reader->buffer_end;
+            }
+            break;
+        }
+        if (count > 0) break;  // Never block on a slow pipe while holding records
+        refill_trace_buffer(reader);
+    }
+    return count;
+}
+
+size_t trace_reader_next_chunk(TraceReader* reader, TraceEntry* entries, size_t max_entries) {
+    PROFILE_SCOPE(PROFILE_TRACE_PARSE);
+    size_t count;
+    if (reader->binary) {
+        count = next_chunk_binary(reader, entries, max_entries);
+    } else if (reader->map) {
+        count = next_chunk_mapped(reader, entries, max_entries);
+    } else {
+        count = next_chunk_buffered(reader, entries, max_entries);
     }
-    
-    *traces = (TraceEntry*)malloc(sizeof(TraceEntry) * count);
+    reader->records += count;
+
+    // A header count that disagrees with what decoded means the file was cut short or damaged
+    if (count == 0 && reader->binary && !reader->count_checked) {
+        reader->count_checked = true;
+        if (reader->declared_records != BINARY_TRACE_UNKNOWN_COUNT &&
+            reader->declared_records != reader->records) {
+            fprintf(stderr, "Binary trace is truncated or corrupt: header declares %llu records, read %llu\n",
+                    (unsigned long long)reader->declared_records, (unsigned long long)reader->records);
+        }
+    }
+    return count;
+}
+
+int read_usimm_trace(const char* filename, TraceEntry** traces, size_t* num_traces) {
+    TraceReader* reader = open_trace_reader(filename);
+    if (!reader) return -1;
+
+    size_t capacity = TRACE_CHUNK_ENTRIES;
+    size_t count = 0;
+    *traces = (TraceEntry*)malloc(sizeof(TraceEntry) * capacity);
     if (!*traces) {
         fprintf(stderr, "Failed to allocate memory for traces\n");
-        fclose(file);
+        close_trace_reader(reader);
         return -1;
     }
-    
-    rewind(file);
-    int i = 0;
-    while (fgets(line, sizeof(line), file) && i < count) {
-        if (line[0] == '#' || line[0] == '\n') continue;
-        
-        char op;
-        uint32_t address;
-        int size = 0;
-        char data_str[32] = {0};
-        
-        // Parse the line based on operation type
-        int parsed = sscanf(line, "%c %x, %d, %s", &op, &address, &size, data_str);
-        
-        if (parsed < 2) continue;  // Skip malformed lines
-        
-        TraceEntry entry;
-        entry.address = address;
-        
-        switch (toupper(op)) {
-            case 'I':
-                entry.op = TRACE_INSTRUCTION;
-                entry.size = (parsed >= 3) ? size : 0;
-                memset(entry.data, 0, sizeof(entry.data));
-                break;
-            case 'L':
-                entry.op = TRACE_LOAD;
-                entry.size = (parsed >= 3) ? size : 4;  // Default to 4 bytes
-                memset(entry.data, 0, sizeof(entry.data));
-                break;
-            case 'S':
-                entry.op = TRACE_STORE;
-                entry.size = (parsed >= 3) ? size : 4;  // Default to 4 bytes
-                if (parsed >= 4) {
-                    hex_string_to_bytes(data_str, entry.data, entry.size);
-                } else {
-                    memset(entry.data, 0, sizeof(entry.data));
-                }
-                break;
-            case 'M':
-                entry.op = TRACE_MODIFY;
-                entry.size = (parsed >= 3) ? size : 4;  // Default to 4 bytes
-                if (parsed >= 4) {
-                    hex_string_to_bytes(data_str, entry.data, entry.size);
-                } else {
-                    memset(entry.data, 0, sizeof(entry.data));
-                }
-                break;
-            default:
-                continue;  // Skip unknown operations
-        }
-        
-        (*traces)[i++] = entry;
-    }
-    
-    *num_traces = i;
-    fclose(file);
+
+    for (;;) {
+        if (capacity - count < TRACE_CHUNK_ENTRIES) {
+            capacity *= 2;
+            TraceEntry* grown = (TraceEntry*)realloc(*traces, sizeof(TraceEntry) * capacity);
+            if (!grown) {
+                fprintf(stderr, "Failed to allocate memory for traces\n");
+                free(*traces);
+                *traces = NULL;
+                close_trace_reader(reader);
+                return -1;
+            }
+            *traces = grown;
+        }
+        size_t got = trace_reader_next_chunk(reader, *traces + count, TRACE_CHUNK_ENTRIES);
+        if (got == 0) break;
+        count += got;
+    }
+
+    close_trace_reader(reader);
+    *num_traces = count;
     return 0;
 }
 
-void process_usimm_trace(CacheController* controller, const char* filename) {
-    TraceEntry* traces = NULL;
-    int num_traces = 0;
-    
-    if (read_usimm_trace(filename, &traces, &num_traces) < 0) {
-        fprintf(stderr, "Failed to read trace file\n");
-        return;
+void simulate_trace_entry(CacheController* controller, const TraceEntry* entry) {
+    switch (entry->op) {
+        case TRACE_INSTRUCTION:
+            // Instruction fetch - treat as read
+            controller_read(controller, entry->address, NULL);
+            break;
+        case TRACE_LOAD:
+            // Load operation - read
+            {
+                uint8_t data[8];
+                controller_read(controller, entry->address, data);
+            }
+            break;
+        case TRACE_STORE:
+        case TRACE_MODIFY:
+            // Store or modify operation - write
+            controller_write(controller, entry->address, (uint8_t*)entry->data);
+            break;
     }
-    
-    printf("Processing %d trace entries from %s\n", num_traces, filename);
-    
-    for (int i = 0; i < num_traces; i++) {
-        TraceEntry entry = traces[i];
-        
-        switch (entry.op) {
-            case TRACE_INSTRUCTION:
-                // Instruction fetch - treat as read
-                controller_read(controller, entry.address, NULL);
-                break;
-            case TRACE_LOAD:
-                // Load operation - read
-                {
-                    uint8_t data[8];
-                    controller_read(controller, entry.address, data);
-                }
-                break;
-            case TRACE_STORE:
-            case TRACE_MODIFY:
-                // Store or modify operation - write
-                controller_write(controller, entry.address, entry.data);
-                break;
-        }
-        
-        if ((i + 1) % 10000 == 0 || i == num_traces - 1) {
-            printf("Processed %d/%d entries (%.1f%%)\n", 
-                  i + 1, num_traces, (float)(i + 1) / num_traces * 100);
-            
-            if ((i + 1) % 100000 == 0) {
-                print_controller_stats(controller);
+}
+
+void simulate_trace_entry_enhanced(EnhancedCacheController* controller, const TraceEntry* entry) {
+    switch (entry->op) {
+        case TRACE_INSTRUCTION:
+            // Instruction fetch - treat as read
+            {
+                uint8_t data[8];
+                enhanced_read(controller, entry->address, data);
+            }
+            break;
+        case TRACE_LOAD:
+            // Load operation - read
+            {
+                uint8_t data[8];
+                enhanced_read(controller, entry->address, data);
+            }
+            break;
+        case TRACE_STORE:
+        case TRACE_MODIFY:
+            // Store or modify operation - write
+            enhanced_write(controller, entry->address, (uint8_t*)entry->data);
+            break;
+    }
+}
+
+uint64_t trace_run_next_report(const TraceRun* run) {
+    uint64_t next = UINT64_MAX;
+    if (!run) return next;
+    if (run->progress_interval) {
+        next = (run->records / run->progress_interval + 1) * run->progress_interval;
+    }
+    if (run->stats && run->stats->interval) {
+        uint64_t sample = (run->records / run->stats->interval + 1) * run->stats->interval;
+        if (sample < next) next = sample;
+    }
+    return next;
+}
+
+uint64_t trace_run_report(TraceRun* run) {
+    if (run->progress_interval && run->records % run->progress_interval == 0) {
+        printf("Processed %llu entries\n", (unsigned long long)run->records);
+    }
+    if (run->stats && run->stats->interval && run->records % run->stats->interval == 0) {
+        stats_snapshot(run->stats, run->records);
+    }
+    return trace_run_next_report(run);
+}
+
+// Fill `entries` from a built-in workload, as trace_reader_next_chunk does from a file
+static size_t workload_next_chunk(WorkloadGenerator* generator, TraceEntry* entries, size_t max_entries) {
+    size_t count = 0;
+    uint32_t address;
+    bool is_write;
+    uint64_t random;
+    while (count < max_entries && workload_next(generator, &address, &is_write, &random)) {
+        TraceEntry* entry = &entries[count++];
+        entry->op = is_write ? TRACE_STORE : TRACE_LOAD;
+        entry->address = address;
+        entry->size = WORKLOAD_ACCESS_SIZE;
+        memcpy(entry->data, &random, sizeof(entry->data));
+    }
+    return count;
+}
+
+/**
+ * Replay loop shared by both controllers and by trace files and built-in
+ * workloads. Reports are due at a known record count, so the per-record
+ * cost is one compare.
+ */
+template <typename Controller, void (*simulate)(Controller*, const TraceEntry*),
+          typename Source = TraceReader,
+          size_t (*next_chunk)(Source*, TraceEntry*, size_t) = trace_reader_next_chunk>
+static uint64_t replay_trace(Controller* controller, Source* source, TraceRun* run) {
+    TraceEntry chunk[TRACE_CHUNK_ENTRIES];
+    uint64_t start = run ? run->records : 0;
+    uint64_t processed = 0;
+    uint64_t report_at = trace_run_next_report(run);
+    size_t got;
+
+    while ((got = next_chunk(source, chunk, TRACE_CHUNK_ENTRIES)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            simulate(controller, &chunk[i]);
+
+            processed++;
+            if (start + processed == report_at) {
+                run->records = start + processed;
+                report_at = trace_run_report(run);
             }
         }
     }
-    
+
+    if (run) run->records = start + processed;
+    return processed;
+}
+
+void process_usimm_trace(CacheController* controller, const char* filename, TraceRun* run) {
+    TraceReader* reader = open_trace_reader(filename);
+    if (!reader) {
+        fprintf(stderr, "Failed to read trace file\n");
+        return;
+    }
+
+    printf("Processing trace entries from %s\n", filename);
+    uint64_t processed = replay_trace<CacheController, simulate_trace_entry>(controller, reader, run);
+
+    printf("Processed %llu entries in total\n", (unsigned long long)processed);
+    close_trace_reader(reader);
+
     // Print final statistics
     printf("\nFinal Statistics:\n");
     print_controller_stats(controller);
-    
-    free(traces);
 }
 
-void process_usimm_trace_enhanced(EnhancedCacheController* controller, const char* filename) {
-    TraceEntry* traces = NULL;
-    int num_traces = 0;
-    
-    if (read_usimm_trace(filename, &traces, &num_traces) < 0) {
+void process_usimm_trace_enhanced(EnhancedCacheController* controller, const char* filename, TraceRun* run) {
+    TraceReader* reader = open_trace_reader(filename);
+    if (!reader) {
         fprintf(stderr, "Failed to read trace file\n");
         return;
     }
-    
-    printf("Processing %d trace entries from %s with enhanced controller\n", num_traces, filename);
-    
-    for (int i = 0; i < num_traces; i++) {
-        TraceEntry entry = traces[i];
-        
-        switch (entry.op) {
-            case TRACE_INSTRUCTION:
-                // Instruction fetch - treat as read
-                {
-                    uint8_t data[8];
-                    enhanced_read(controller, entry.address, data);
-                }
-                break;
-            case TRACE_LOAD:
-                // Load operation - read
-                {
-                    uint8_t data[8];
-                    enhanced_read(controller, entry.address, data);
-                }
-                break;
-            case TRACE_STORE:
-            case TRACE_MODIFY:
-                // Store or modify operation - write
-                enhanced_write(controller, entry.address, entry.data);
-                break;
-        }
-        
-        if ((i + 1) % 10000 == 0 || i == num_traces - 1) {
-            printf("Processed %d/%d entries (%.1f%%)\n", 
-                  i + 1, num_traces, (float)(i + 1) / num_traces * 100);
-        }
-    }
-    
-    flush_write_buffer(controller->write_buffer, controller->L1);
+
+    printf("Processing trace entries from %s with enhanced controller\n", filename);
+    uint64_t processed = replay_trace<EnhancedCacheController, simulate_trace_entry_enhanced>(controller, reader, run);
+
+    printf("Processed %llu entries in total\n", (unsigned long long)processed);
+    close_trace_reader(reader);
+
+    drain_write_buffer(controller);
+    print_enhanced_stats(controller);
+}
+
+int process_workload(CacheController* controller, const WorkloadConfig* config, TraceRun* run) {
+    WorkloadGenerator* generator = create_workload_generator(config);
+    if (!generator) return -1;
+
+    print_workload_config(config);
+    uint64_t processed = replay_trace<CacheController, simulate_trace_entry,
+                                      WorkloadGenerator, workload_next_chunk>(controller, generator, run);
+    printf("Processed %llu entries in total\n", (unsigned long long)processed);
+    free_workload_generator(generator);
+
+    printf("\nFinal Statistics:\n");
+    print_controller_stats(controller);
+    return 0;
+}
+
+int process_workload_enhanced(EnhancedCacheController* controller, const WorkloadConfig* config, TraceRun* run) {
+    WorkloadGenerator* generator = create_workload_generator(config);
+    if (!generator) return -1;
+
+    print_workload_config(config);
+    uint64_t processed = replay_trace<EnhancedCacheController, simulate_trace_entry_enhanced,
+                                      WorkloadGenerator, workload_next_chunk>(controller, generator, run);
+    printf("Processed %llu entries in total\n", (unsigned long long)processed);
+    free_workload_generator(generator);
+
+    drain_write_buffer(controller);
     print_enhanced_stats(controller);
-    free(traces);
-}
\ No newline at end of file
+    return 0;
+}
+
+void process_usimm_trace_stack_distance(StackDistanceProfile* profile, const char* filename) {
+    TraceReader* reader = open_trace_reader(filename);
+    if (!reader) {
+        fprintf(stderr, "Failed to read trace file\n");
+        return;
+    }
+
+    TraceEntry chunk[TRACE_CHUNK_ENTRIES];
+    size_t got;
+
+    printf("Computing stack distances for %s\n", filename);
+
+    // Every operation allocates in L1, so loads, fetches and stores all
+    // move the block to the top of its set's LRU stack
+    while ((got = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_ENTRIES)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            stack_distance_access(profile, chunk[i].address);
+        }
+    }
+
+    printf("Processed %llu entries in total\n", (unsigned long long)reader->records);
+    close_trace_reader(reader);
+}
@@ -0,0 +1,138 @@
+/**
+ * victim_cache.cpp
+ * Small fully-associative victim cache between L1 and L2
+ */
+
+#include "victim_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VICTIM_BLOCK_SIZE (1u << BLOCK_OFFSET_BITS)
+
+VictimCache* create_victim_cache(uint32_t entries, bool dataless) {
+    if (entries < VICTIM_CACHE_MIN_ENTRIES || entries > VICTIM_CACHE_MAX_ENTRIES) {
+        fprintf(stderr, "Victim cache must have %d to %d entries\n",
+                VICTIM_CACHE_MIN_ENTRIES, VICTIM_CACHE_MAX_ENTRIES);
+        return NULL;
+    }
+
+    VictimCache* vc = (VictimCache*)calloc(1, sizeof(VictimCache));
+    if (!vc) return NULL;
+    vc->capacity = entries;
+    if (!dataless) {
+        vc->data = (uint8_t*)malloc((size_t)entries * VICTIM_BLOCK_SIZE);
+        if (!vc->data) {
+            free(vc);
+            return NULL;
+        }
+    }
+    return vc;
+}
+
+void free_victim_cache(VictimCache* vc) {
+    if (vc) {
+        free(vc->data);
+        free(vc);
+    }
+}
+
+int32_t victim_cache_find(const VictimCache* vc, uint32_t block_address) {
+    uint32_t valid = vc->valid_mask;
+    while (valid) {
+        uint32_t i = (uint32_t)__builtin_ctz(valid);
+        if (vc->blocks[i] == block_address) return (int32_t)i;
+        valid &= valid - 1;
+    }
+    return -1;
+}
+
+uint8_t* victim_cache_line_data(VictimCache* vc, uint32_t entry) {
+    return vc->data ? vc->data + (size_t)entry * VICTIM_BLOCK_SIZE : NULL;
+}
+
+void victim_cache_mark_dirty(VictimCache* vc, uint32_t entry) {
+    vc->dirty_mask |= 1u << entry;
+}
+
+static void copy_out(VictimCache* vc, uint32_t entry, VictimLine* line) {
+    line->block_address = vc->blocks[entry];
+    line->dirty = (vc->dirty_mask >> entry) & 1;
+    if (vc->data) memcpy(line->data, victim_cache_line_data(vc, entry), VICTIM_BLOCK_SIZE);
+}
+
+bool victim_cache_remove(VictimCache* vc, uint32_t entry) {
+    bool dirty = (vc->dirty_mask >> entry) & 1;
+
+    // Close the gap in the recency order
+    uint32_t valid = vc->valid_mask & ~(1u << entry);
+    while (valid) {
+        uint32_t i = (uint32_t)__builtin_ctz(valid);
+        if (vc->rank[i] > vc->rank[entry]) vc->rank[i]--;
+        valid &= valid - 1;
+    }
+    vc->valid_mask &= ~(1u << entry);
+    vc->dirty_mask &= ~(1u << entry);
+    return dirty;
+}
+
+bool victim_cache_take(VictimCache* vc, uint32_t block_address, VictimLine* line) {
+    vc->probes++;
+    int32_t found = victim_cache_find(vc, block_address);
+    if (found < 0) return false;
+
+    copy_out(vc, (uint32_t)found, line);
+    victim_cache_remove(vc, (uint32_t)found);
+    vc->hits++;
+    return true;
+}
+
+bool victim_cache_put(VictimCache* vc, uint32_t block_address, const uint8_t* data, bool dirty,
+                      VictimLine* evicted) {
+    uint32_t full = vc->capacity == 32 ? ~0u : (1u << vc->capacity) - 1;
+    uint32_t free_entries = ~vc->valid_mask & full;
+    uint32_t entry = 0;
+    bool evicting = free_entries == 0;
+
+    if (evicting) {
+        // The least recently used entry holds the highest rank
+        while (vc->rank[entry] != vc->capacity - 1) entry++;
+        copy_out(vc, entry, evicted);
+        vc->evictions++;
+    } else {
+        entry = (uint32_t)__builtin_ctz(free_entries);
+    }
+
+    uint32_t valid = vc->valid_mask & ~(1u << entry);
+    while (valid) {
+        uint32_t i = (uint32_t)__builtin_ctz(valid);
+        vc->rank[i]++;
+        valid &= valid - 1;
+    }
+
+    vc->blocks[entry] = block_address;
+    vc->rank[entry] = 0;
+    vc->valid_mask |= 1u << entry;
+    if (dirty) {
+        vc->dirty_mask |= 1u << entry;
+    } else {
+        vc->dirty_mask &= ~(1u << entry);
+    }
+    if (data && vc->data) memcpy(victim_cache_line_data(vc, entry), data, VICTIM_BLOCK_SIZE);
+    vc->fills++;
+    return evicting;
+}
+
+void print_victim_cache_stats(const VictimCache* vc, uint32_t latency, uint64_t l1_misses) {
+    printf("===== Victim Cache Statistics =====\n");
+    printf("Entries: %u, fully associative, %u cycles after an L1 miss\n", vc->capacity, latency);
+    printf("Probes: %llu, hits: %llu (%.2f%% of probes, %.2f%% of L1 misses)\n",
+           (unsigned long long)vc->probes, (unsigned long long)vc->hits,
+           vc->probes > 0 ? (double)vc->hits / vc->probes * 100 : 0,
+           l1_misses > 0 ? (double)vc->hits / l1_misses * 100 : 0);
+    printf("Swaps with L1: %llu\n", (unsigned long long)vc->swaps);
+    printf("Lines from L1: %llu, evicted: %llu, written back to L2: %llu\n",
+           (unsigned long long)vc->fills, (unsigned long long)vc->evictions,
+           (unsigned long long)vc->write_backs);
+    printf("===================================\n");
+}
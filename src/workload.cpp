@@ -0,0 +1,191 @@
+/**
+ * workload.cpp
+ * Built-in synthetic workloads, generated as they are simulated
+ */
+
+#include "workload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+// Spreads Zipf ranks over the slots (odd, so a bijection modulo a power of two)
+#define ZIPF_SCATTER 0x9E3779B1u
+
+void default_workload_config(WorkloadConfig* config) {
+    config->pattern = WORKLOAD_SEQUENTIAL;
+    config->footprint = WORKLOAD_DEFAULT_FOOTPRINT;
+    config->stride = WORKLOAD_DEFAULT_STRIDE;
+    config->accesses = WORKLOAD_DEFAULT_ACCESSES;
+    config->write_percent = WORKLOAD_DEFAULT_WRITES;
+    config->seed = 1;
+}
+
+bool check_workload_config(const WorkloadConfig* config) {
+    uint32_t footprint = config->footprint;
+    uint32_t stride = config->stride;
+    if (footprint == 0 || (footprint & (footprint - 1)) != 0 || footprint > 1u << 31) {
+        fprintf(stderr, "Workload footprint (%u) must be a power of two up to 2G\n", footprint);
+        return false;
+    }
+    if ((stride & (stride - 1)) != 0 || stride < WORKLOAD_ACCESS_SIZE || stride > footprint) {
+        fprintf(stderr, "Workload stride (%u) must be a power of two from %d to the footprint\n",
+                stride, WORKLOAD_ACCESS_SIZE);
+        return false;
+    }
+    if (config->write_percent > 100) {
+        fprintf(stderr, "Workload write percentage (%u) exceeds 100\n", config->write_percent);
+        return false;
+    }
+    return true;
+}
+
+const char* workload_pattern_name(WorkloadPattern pattern) {
+    switch (pattern) {
+        case WORKLOAD_SEQUENTIAL: return "sequential";
+        case WORKLOAD_STRIDED: return "strided";
+        case WORKLOAD_RANDOM: return "random";
+        case WORKLOAD_ZIPF: return "zipf";
+        case WORKLOAD_POINTER_CHASE: return "pointer-chase";
+    }
+    return "unknown";
+}
+
+bool parse_workload_pattern(const char* name, WorkloadPattern* pattern) {
+    static const WorkloadPattern all[] = { WORKLOAD_SEQUENTIAL, WORKLOAD_STRIDED, WORKLOAD_RANDOM,
+                                           WORKLOAD_ZIPF, WORKLOAD_POINTER_CHASE };
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        if (strcasecmp(name, workload_pattern_name(all[i])) == 0) {
+            *pattern = all[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// splitmix64: any seed, including 0, gives a full-period stream
+static inline uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1) from the top 53 bits
+static inline double random_unit(uint64_t* state) {
+    return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void init_zipf(WorkloadGenerator* g, uint64_t slots) {
+    double theta = WORKLOAD_ZIPF_THETA;
+    double zeta_2 = 1.0 + pow(0.5, theta);
+    double zeta_n = 0;
+    for (uint64_t i = 1; i <= slots; i++) zeta_n += pow((double)i, -theta);
+
+    g->zeta_n = zeta_n;
+    g->alpha = 1.0 / (1.0 - theta);
+    g->eta = (1.0 - pow(2.0 / slots, 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+    g->half_pow_theta = pow(0.5, theta);
+}
+
+static uint32_t zipf_rank(WorkloadGenerator* g) {
+    double u = random_unit(&g->rng);
+    double uz = u * g->zeta_n;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + g->half_pow_theta) return 1;
+    uint64_t slots = 1ULL << g->slot_bits;
+    uint64_t rank = (uint64_t)(slots * pow(g->eta * u - g->eta + 1.0, g->alpha));
+    return (uint32_t)(rank < slots ? rank : slots - 1);
+}
+
+/**
+ * Sattolo's shuffle of the identity gives a uniformly random permutation
+ * made of a single cycle, so following next_slot[] from any slot visits
+ * every slot before returning to it.
+ */
+static bool init_pointer_chase(WorkloadGenerator* g, uint64_t slots) {
+    uint32_t* next = (uint32_t*)malloc(sizeof(uint32_t) * slots);
+    if (!next) return false;
+    for (uint64_t i = 0; i < slots; i++) next[i] = (uint32_t)i;
+    for (uint64_t i = slots - 1; i > 0; i--) {
+        uint64_t j = next_random(&g->rng) % i;
+        uint32_t t = next[i];
+        next[i] = next[j];
+        next[j] = t;
+    }
+    g->next_slot = next;
+    return true;
+}
+
+WorkloadGenerator* create_workload_generator(const WorkloadConfig* config) {
+    if (!check_workload_config(config)) return NULL;
+    WorkloadGenerator* g = (WorkloadGenerator*)calloc(1, sizeof(WorkloadGenerator));
+    if (!g) return NULL;
+    g->config = *config;
+    g->rng = config->seed;
+    g->slot_bits = (uint32_t)__builtin_ctz(config->footprint) - (uint32_t)__builtin_ctz(config->stride);
+
+    uint64_t slots = 1ULL << g->slot_bits;
+    if (config->pattern == WORKLOAD_ZIPF) {
+        init_zipf(g, slots);
+    } else if (config->pattern == WORKLOAD_POINTER_CHASE && !init_pointer_chase(g, slots)) {
+        fprintf(stderr, "Failed to allocate the pointer-chase cycle (%llu slots)\n",
+                (unsigned long long)slots);
+        free(g);
+        return NULL;
+    }
+    return g;
+}
+
+void free_workload_generator(WorkloadGenerator* generator) {
+    if (generator) {
+        free(generator->next_slot);
+        free(generator);
+    }
+}
+
+bool workload_next(WorkloadGenerator* g, uint32_t* address, bool* is_write, uint64_t* random) {
+    const WorkloadConfig* config = &g->config;
+    if (g->generated == config->accesses) return false;
+    g->generated++;
+
+    uint32_t slot_mask = (uint32_t)((1ULL << g->slot_bits) - 1);
+    uint32_t stride_bits = (uint32_t)__builtin_ctz(config->stride);
+    switch (config->pattern) {
+        case WORKLOAD_SEQUENTIAL:
+        case WORKLOAD_STRIDED:
+            *address = g->position;
+            g->position += config->pattern == WORKLOAD_SEQUENTIAL ? WORKLOAD_ACCESS_SIZE : config->stride;
+            g->position &= config->footprint - 1;
+            break;
+        case WORKLOAD_RANDOM:
+            *address = ((uint32_t)next_random(&g->rng) & slot_mask) << stride_bits;
+            break;
+        case WORKLOAD_ZIPF:
+            *address = ((zipf_rank(g) * ZIPF_SCATTER) & slot_mask) << stride_bits;
+            break;
+        case WORKLOAD_POINTER_CHASE:
+            *address = g->position << stride_bits;
+            g->position = g->next_slot[g->position];
+            break;
+    }
+
+    *random = next_random(&g->rng);
+    *is_write = *random % 100 < config->write_percent;
+    return true;
+}
+
+static void print_size(const char* label, uint32_t bytes) {
+    if (bytes >= 1u << 20 && bytes % (1u << 20) == 0) printf("%s %uM", label, bytes >> 20);
+    else if (bytes >= 1u << 10 && bytes % (1u << 10) == 0) printf("%s %uK", label, bytes >> 10);
+    else printf("%s %u", label, bytes);
+}
+
+void print_workload_config(const WorkloadConfig* config) {
+    printf("Workload: %s,", workload_pattern_name(config->pattern));
+    print_size(" footprint", config->footprint);
+    if (config->pattern != WORKLOAD_SEQUENTIAL) print_size(", stride", config->stride);
+    printf(", %llu accesses, %u%% writes, seed %llu\n", (unsigned long long)config->accesses,
+           config->write_percent, (unsigned long long)config->seed);
+}
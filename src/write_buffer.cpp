@@ -5,102 +5,124 @@
 
  #include "write_buffer.h"
  #include "cache.h"  // For BLOCK_OFFSET_BITS and Cache definition
+ #include "profile.h"
  #include <stdlib.h>
  #include <string.h>
  
- WriteBuffer* create_write_buffer() {
-     WriteBuffer* wb = (WriteBuffer*)malloc(sizeof(WriteBuffer));
+ WriteBuffer* create_write_buffer(uint32_t depth, uint32_t drain_threshold) {
+     if (depth == 0 || depth > WRITE_BUFFER_MAX_SIZE || drain_threshold > depth) {
+         return NULL;
+     }
+     
+     WriteBuffer* wb = (WriteBuffer*)calloc(1, sizeof(WriteBuffer));
      if (!wb) return NULL;
      
-     for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-         wb->entries[i].valid = false;
-         wb->entries[i].dirty = false;
-         wb->entries[i].address = 0;
-         wb->entries[i].insertion_time = 0;
-     }
+     // At least two buckets per entry keeps chains to one or two links
+     wb->bucket_bits = 1;
+     while ((1u << wb->bucket_bits) < 2 * depth) wb->bucket_bits++;
      
-     wb->num_entries = 0;
-     wb->counter = 0;
-     wb->write_backs = 0;
-     wb->coalesced_writes = 0;
+     wb->entries = (WriteBufferEntry*)calloc(depth, sizeof(WriteBufferEntry));
+     wb->buckets = (int32_t*)malloc(sizeof(int32_t) << wb->bucket_bits);
+     if (!wb->entries || !wb->buckets) {
+         free_write_buffer(wb);
+         return NULL;
+     }
+     memset(wb->buckets, 0xFF, sizeof(int32_t) << wb->bucket_bits);  // all -1
      
+     wb->depth = depth;
+     wb->drain_threshold = drain_threshold;
      return wb;
  }
  
+ void free_write_buffer(WriteBuffer* wb) {
+     if (wb) {
+         free(wb->entries);
+         free(wb->buckets);
+         free(wb);
+     }
+ }
+ 
+ static inline uint32_t bucket_of(const WriteBuffer* wb, uint32_t block_address) {
+     return ((block_address >> BLOCK_OFFSET_BITS) * 0x9E3779B1u) >> (32 - wb->bucket_bits);
+ }
+ 
+ static WriteBufferEntry* find_entry(WriteBuffer* wb, uint32_t block_address) {
+     for (int32_t i = wb->buckets[bucket_of(wb, block_address)]; i >= 0; i = wb->entries[i].next) {
+         if (wb->entries[i].block_address == block_address) {
+             return &wb->entries[i];
+         }
+     }
+     return NULL;
+ }
+ 
  bool check_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data) {
+     PROFILE_SCOPE(PROFILE_CHECK_WRITE_BUFFER);
      uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
      uint32_t offset = address & ((1 << BLOCK_OFFSET_BITS) - 1);
      
-     for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-         if (wb->entries[i].valid && 
-             (wb->entries[i].address & ~((1 << BLOCK_OFFSET_BITS) - 1)) == block_address) {
-             if (data) {
-                 memcpy(data, &wb->entries[i].data[offset], 1);
-             }
-             return true;
-         }
+     WriteBufferEntry* entry = find_entry(wb, block_address);
+     if (!entry || !((entry->byte_mask >> offset) & 1)) {
+         return false;
      }
      
-     return false;
+     if (data) {
+         memcpy(data, &entry->data[offset], 1);
+     }
+     wb->forwarded_reads++;
+     return true;
  }
  
- void insert_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data) {
+ bool insert_write_buffer(WriteBuffer* wb, uint32_t address, uint8_t* data) {
+     PROFILE_SCOPE(PROFILE_INSERT_WRITE_BUFFER);
      uint32_t block_address = address & ~((1 << BLOCK_OFFSET_BITS) - 1);
      uint32_t offset = address & ((1 << BLOCK_OFFSET_BITS) - 1);
      
-     for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-         if (wb->entries[i].valid && 
-             (wb->entries[i].address & ~((1 << BLOCK_OFFSET_BITS) - 1)) == block_address) {
-             memcpy(&wb->entries[i].data[offset], data, 1);
-             wb->entries[i].dirty = true;
-             wb->entries[i].insertion_time = wb->counter++;
-             wb->coalesced_writes++;
-             return;
-         }
-     }
-     
-     if (wb->num_entries == WRITE_BUFFER_SIZE) {
-         uint32_t oldest_idx = 0;
-         uint64_t oldest_time = UINT64_MAX;
-         
-         for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-             if (wb->entries[i].insertion_time < oldest_time) {
-                 oldest_time = wb->entries[i].insertion_time;
-                 oldest_idx = i;
-             }
-         }
+     WriteBufferEntry* entry = find_entry(wb, block_address);
+     if (entry) {
+         wb->coalesced_writes++;
+     } else {
+         if (wb->num_entries == wb->depth) return false;
          
-         wb->write_backs++;
-         wb->entries[oldest_idx].valid = false;
-         wb->num_entries--;
+         int32_t slot = (int32_t)((wb->head + wb->num_entries) % wb->depth);
+         uint32_t bucket = bucket_of(wb, block_address);
+         entry = &wb->entries[slot];
+         entry->block_address = block_address;
+         entry->byte_mask = 0;
+         entry->next = wb->buckets[bucket];
+         wb->buckets[bucket] = slot;
+         wb->num_entries++;
      }
      
-     int empty_idx = -1;
-     for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-         if (!wb->entries[i].valid) {
-             empty_idx = i;
-             break;
-         }
+     entry->byte_mask |= 1ULL << offset;
+     // A NULL payload means the caller simulates tags only
+     if (data) {
+         memcpy(&entry->data[offset], data, 1);
      }
+     return true;
+ }
+ 
+ const WriteBufferEntry* write_buffer_oldest(const WriteBuffer* wb) {
+     return wb->num_entries > 0 ? &wb->entries[wb->head] : NULL;
+ }
+ 
+ void write_buffer_pop(WriteBuffer* wb) {
+     PROFILE_SCOPE(PROFILE_WRITE_BUFFER_POP);
+     if (wb->num_entries == 0) return;
      
-     if (empty_idx != -1) {
-         wb->entries[empty_idx].valid = true;
-         wb->entries[empty_idx].dirty = true;
-         wb->entries[empty_idx].address = block_address;
-         wb->entries[empty_idx].insertion_time = wb->counter++;
-         
-         memset(wb->entries[empty_idx].data, 0, WB_BLOCK_SIZE);
-         memcpy(&wb->entries[empty_idx].data[offset], data, 1);
-         
-         wb->num_entries++;
+     int32_t slot = (int32_t)wb->head;
+     int32_t* link = &wb->buckets[bucket_of(wb, wb->entries[slot].block_address)];
+     while (*link != slot) {
+         link = &wb->entries[*link].next;
      }
+     *link = wb->entries[slot].next;
+     
+     wb->head = (wb->head + 1) % wb->depth;
+     wb->num_entries--;
  }
  
- void flush_write_buffer(WriteBuffer* wb, Cache* cache) {
-     for (int i = 0; i < WRITE_BUFFER_SIZE; i++) {
-         if (wb->entries[i].valid && wb->entries[i].dirty) {
-             cache_write(cache, wb->entries[i].address, wb->entries[i].data);
-             wb->entries[i].dirty = false;
-         }
+ void merge_write_buffer_entry(const WriteBufferEntry* entry, uint8_t* block) {
+     for (uint64_t mask = entry->byte_mask; mask; mask &= mask - 1) {
+         uint32_t offset = (uint32_t)__builtin_ctzll(mask);
+         block[offset] = entry->data[offset];
      }
- }
\ No newline at end of file
+ }